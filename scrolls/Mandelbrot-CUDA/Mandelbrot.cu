@@ -13,6 +13,7 @@
   #include <GL/glfw.h>
 #endif
 #include "Timer.h"
+#include "Formulas.h"
 #include "Mandelbrot.h"
 using namespace std;
 
@@ -27,10 +28,24 @@ using namespace std;
   #define CUDA_ERROR(x) x
 #endif
 
+/// Whether c lies inside the main cardioid or the period-2 bulb, where every
+/// point is interior.  Branch-free, so a warp never diverges on it.
+__device__ bool in_main_bulbs(float cr, float ci)
+{
+  float yy = ci * ci;
+  float a = cr - 0.25f;
+  float q = a * a + yy;
+  float b = cr + 1;
+  return (q * (q + a) < yy * 0.25f) | (b * b + yy < 0.0625f);
+}
+
 /// Basic implementation of Mandelbrot on CUDA
 /// Completely unoptimised, and is only good for 1024x1024 resolution at this stage.
+/// The orbit is stepped by one of the formula policies of the threaded
+/// renderer (see Formulas.h), compiled in, so the loop never branches on it.
 /// TODO: Look into CUDA textures
 /// TODO: Test with OpenGL Shaders, and use that as a baseline benchmark speed for optimising this kernel.
+template <class Formula>
 __global__ void mandelbrot(unsigned char * data, int width, int height, float tx, float ty, float scale, int limit)
 {
   unsigned int u = blockIdx.x * blockDim.x + threadIdx.x;
@@ -44,15 +59,13 @@ __global__ void mandelbrot(unsigned char * data, int width, int height, float tx
       float cr = float(u*4 + j + tx) / width * scale;
       float ci = float(v*4 + i + ty) / height * scale;
 
-      int c = 0;
-      float tmp, x = 0, y = 0;
+      /// Interior points start at the limit, and skip the loop entirely.
+      int c = Formula::main_bulbs && in_main_bulbs(cr, ci) ? limit : 0;
+      float x = 0, y = 0;
       /// Surely we can fold this? Don't have time, but perhaps a PDE can be derived here and find the
       /// difference equation to save on loops
-      while ((x*x + y*y < 4) && (c++ < limit)) {
-          tmp = x*x - y*y + cr;
-          y = 2 * x * y + ci;
-          x = tmp;
-      }
+      while ((x*x + y*y < 4) && (c++ < limit))
+        Formula::template step<Scalar<float> >(x, y, cr, ci);
       /// TODO: Colour remapping so we don't have ugly, static blue colours
       if (c >= limit) {
         data[addr]   =  (unsigned char) 0;
@@ -68,15 +81,60 @@ __global__ void mandelbrot(unsigned char * data, int width, int height, float tx
   }
 }
 
+/// Launches the kernel for the formula in the given power.
+template <template <int> class Formula>
+static void launch_for_power(int power, dim3 blocks, dim3 threads, unsigned char * data,
+                             int width, int height, float tx, float ty, float scale, int limit)
+{
+  switch (power) {
+  case 3:
+    mandelbrot<Formula<3> ><<<blocks, threads>>>(data, width, height, tx, ty, scale, limit);
+    break;
+  case 4:
+    mandelbrot<Formula<4> ><<<blocks, threads>>>(data, width, height, tx, ty, scale, limit);
+    break;
+  case 5:
+    mandelbrot<Formula<5> ><<<blocks, threads>>>(data, width, height, tx, ty, scale, limit);
+    break;
+  case 6:
+    mandelbrot<Formula<6> ><<<blocks, threads>>>(data, width, height, tx, ty, scale, limit);
+    break;
+  case 7:
+    mandelbrot<Formula<7> ><<<blocks, threads>>>(data, width, height, tx, ty, scale, limit);
+    break;
+  case 8:
+    mandelbrot<Formula<8> ><<<blocks, threads>>>(data, width, height, tx, ty, scale, limit);
+    break;
+  default:
+    mandelbrot<Formula<2> ><<<blocks, threads>>>(data, width, height, tx, ty, scale, limit);
+  }
+}
+
+/// Launches the kernel for the formula and power given.
+static void launch(int formula, int power, dim3 blocks, dim3 threads, unsigned char * data,
+                   int width, int height, float tx, float ty, float scale, int limit)
+{
+  switch (formula) {
+  case FORMULA_MULTICORN:
+    launch_for_power<Multicorn>(power, blocks, threads, data, width, height, tx, ty, scale, limit);
+    break;
+  case FORMULA_BURNING_SHIP:
+    launch_for_power<BurningShip>(power, blocks, threads, data, width, height, tx, ty, scale, limit);
+    break;
+  default:
+    launch_for_power<Multibrot>(power, blocks, threads, data, width, height, tx, ty, scale, limit);
+  }
+}
+
 
 Mandelbrot::Mandelbrot(int width, int height)
 {
   this->width = width;
   this->height = height;
   this->limit = 64;
-  this->scale = 3.0f;
-  this->tx = -width * 5 / 7.0f;
-  this->ty = -height / 2.0f;
+  this->formula = FORMULA_MULTIBROT;
+  this->power = 2;
+  frame_whole_set();
   this->data = new unsigned char[width * height * 3];
   memset(this->data, 0, sizeof(data));
   this->size = width * height * 3 * sizeof(unsigned char);
@@ -127,7 +185,7 @@ void Mandelbrot::render()
 
     dim3 threadsPerBlock(16, 16);
     dim3 numBlocks(width/4/threadsPerBlock.x, height/4/threadsPerBlock.y);
-    mandelbrot<<<numBlocks, threadsPerBlock>>>(gpu_data, width, height, tx, ty, scale, limit);
+    launch(formula, power, numBlocks, threadsPerBlock, gpu_data, width, height, tx, ty, scale, limit);
     CUDA_ERROR(cudaThreadSynchronize());
     CUDA_ERROR(cudaMemcpy(data, gpu_data, this->size, cudaMemcpyDeviceToHost));
 
@@ -163,6 +221,21 @@ void Mandelbrot::render()
   }
 }
 
+void Mandelbrot::frame_whole_set()
+{
+  scale = 3.0f;
+  tx = -width / 2.0f;
+  ty = -height / 2.0f;
+  if (power != 2)
+    return;
+  if (formula == FORMULA_MULTIBROT) {
+    tx = -width * 5 / 7.0f;
+  } else if (formula == FORMULA_BURNING_SHIP) {
+    scale = 3.5f;
+    tx = -width * 43 / 70.0f;
+  }
+}
+
 void Mandelbrot::handle_inputs()
 {
   if (glfwGetWindowParam(GLFW_OPENED) == GL_FALSE 
@@ -185,6 +258,20 @@ void Mandelbrot::handle_inputs()
     scale += 0.25f;
   if (glfwGetKey('E') == GLFW_PRESS)
     scale -= 0.25f;
+  /// Number keys pick the power and F1 onwards the formula, and either frames
+  /// the whole set when it changes.
+  for (int p = MIN_POWER; p <= MAX_POWER; ++p) {
+    if (glfwGetKey('0' + p) == GLFW_PRESS && power != p) {
+      power = p;
+      frame_whole_set();
+    }
+  }
+  for (int f = 0; f < FORMULA_COUNT; ++f) {
+    if (glfwGetKey(GLFW_KEY_F1 + f) == GLFW_PRESS && formula != f) {
+      formula = f;
+      frame_whole_set();
+    }
+  }
   if (glfwGetKey(']') == GLFW_PRESS) {
     limit /= 2;
     if (limit < 1) limit = 2;
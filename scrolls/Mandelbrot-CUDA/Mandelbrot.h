@@ -23,6 +23,8 @@
 class Mandelbrot
 {
   int limit;              /// Upper bound number of computing interations per pixel
+  int formula;            /// Escape-time formula, see Formula in Formulas.h
+  int power;              /// Power of z in it, MIN_POWER to MAX_POWER
   float scale;            /// Global scale of the renderer
   float tx;               /// Global translation on x axis
   float ty;               /// Global translation on y axis
@@ -49,6 +51,9 @@ private:
   /// This function returns the fractal at (cr, ci) in the range [0, 1]
   float pixel_at(float cr, float ci); 
 
+  /// Frames the whole set of the formula and power.
+  void frame_whole_set();
+
   /// Grabs user inputs and provides feedback
   void handle_inputs();
 };
\ No newline at end of file
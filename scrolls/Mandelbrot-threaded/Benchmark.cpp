@@ -0,0 +1,389 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Times the number types a reference orbit can be computed in.  Needs none of
+/// the OpenGL libraries; build and run it with
+///
+///   make bench
+///   ./Benchmark
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <set>
+#include <chrono>
+#include "Cpu.h"
+#include "Kernels.h"
+#include "Perturbation.h"
+#include "ThreadPool.h"
+#include "TileScheduler.h"
+#include "BuddhabrotSampler.h"
+using namespace std;
+
+/// Prints the time reference_orbit() takes per iteration in R, at a point in
+/// the main cardioid so that every run goes all the way to the limit.
+template <class R>
+static void bench_orbit(const char * name)
+{
+  const int limit = 100000;
+  R cr = -0.1, ci = 0.1;
+  vector<double> zr, zi;
+  int runs = 0;
+  clock_t start = clock();
+  do {
+    reference_orbit(cr, ci, limit, zr, zi);
+    ++runs;
+  } while (clock() - start < CLOCKS_PER_SEC / 2);
+  double seconds = (clock() - start) / (double)CLOCKS_PER_SEC;
+  cout << "  " << name << ": " << seconds / ((double)runs * limit) * 1e9 << " ns" << endl;
+}
+
+/// Prints the time a row kernel takes for a whole frame of the given view, and
+/// returns it in ms.
+template <class T>
+static double bench_rows(const char * name, typename RowKernel<T>::type row, const View<T> & view)
+{
+  vector<int> counts(view.width);
+  vector<float> norms(view.width);
+  int frames = 0;
+  clock_t start = clock();
+  do {
+    for (int j = 0; j < view.height; ++j)
+      row(view, j, 0, view.width, &counts[0], &norms[0]);
+    ++frames;
+  } while (clock() - start < CLOCKS_PER_SEC / 2);
+  double seconds = (clock() - start) / (double)CLOCKS_PER_SEC;
+  cout << "  " << name << ": " << seconds / frames * 1e3 << " ms" << endl;
+  return seconds / frames * 1e3;
+}
+
+/// bench_rows() for a distance kernel, with its cost against the row kernel
+/// that took baseline ms.
+template <class T>
+static void bench_distance_rows(const char * name, typename DistanceKernel<T>::type row,
+                                const View<T> & view, double baseline)
+{
+  vector<int> counts(view.width);
+  vector<float> norms(view.width);
+  vector<float> distances(view.width);
+  int frames = 0;
+  clock_t start = clock();
+  do {
+    for (int j = 0; j < view.height; ++j)
+      row(view, j, 0, view.width, &counts[0], &norms[0], &distances[0]);
+    ++frames;
+  } while (clock() - start < CLOCKS_PER_SEC / 2);
+  double ms = (clock() - start) / (double)CLOCKS_PER_SEC / frames * 1e3;
+  cout << "  " << name << ": " << ms << " ms, " << ms / baseline << "x" << endl;
+}
+
+/// Times every row kernel this machine supports on a frame of the view.
+static void bench_views(const char * title, const View<double> & view)
+{
+  cout << title << ", " << view.width << "x" << view.height << ", limit " << view.limit
+       << ", per frame" << endl;
+  for (int i = 0; i <= cpu_detect(); ++i) {
+    const KernelSet & kernels = kernels_for((Isa)i);
+    string name = isa_name((Isa)i);
+    bench_rows<float>((name + " float").c_str(), kernels.row_float, view_as<float>(view));
+    bench_rows<double>((name + " double").c_str(), kernels.row_double, view);
+  }
+  bench_rows<float>("reference float", row_scalar<float>, view_as<float>(view));
+  bench_rows<double>("reference double", row_scalar<double>, view);
+  bench_rows<double>("deferred double", row_deferred<double>, view);
+  bench_rows<DoubleDouble>("reference double-double", row_scalar<DoubleDouble>,
+                           view_as<DoubleDouble>(view));
+  bench_rows<DoubleDouble>("deferred double-double", row_deferred<DoubleDouble>,
+                           view_as<DoubleDouble>(view));
+}
+
+/// Times the distance kernels of every instruction set this machine supports
+/// against its row kernels.
+static void bench_distance(const char * title, const View<double> & view)
+{
+  cout << title << ", " << view.width << "x" << view.height << ", limit " << view.limit
+       << ", per frame" << endl;
+  for (int i = 0; i <= cpu_detect(); ++i) {
+    const KernelSet & kernels = kernels_for((Isa)i);
+    string name = isa_name((Isa)i);
+    View<float> view_float = view_as<float>(view);
+    double f = bench_rows<float>((name + " float").c_str(), kernels.row_float, view_float);
+    bench_distance_rows<float>((name + " float distance").c_str(), kernels.distance_float,
+                               view_float, f);
+    double d = bench_rows<double>((name + " double").c_str(), kernels.row_double, view);
+    bench_distance_rows<double>((name + " double distance").c_str(), kernels.distance_double,
+                                view, d);
+  }
+}
+
+/// Prints the time a Newton kernel takes for a whole frame.
+template <class T>
+static void bench_newton_rows(const char * name, typename NewtonKernel<T>::type row,
+                              const View<T> & view, const Polynomial<T> & poly)
+{
+  vector<int> counts(view.width);
+  vector<int> roots(view.width);
+  int frames = 0;
+  clock_t start = clock();
+  do {
+    for (int j = 0; j < view.height; ++j)
+      row(view, poly, j, 0, view.width, &counts[0], &roots[0]);
+    ++frames;
+  } while (clock() - start < CLOCKS_PER_SEC / 2);
+  double seconds = (clock() - start) / (double)CLOCKS_PER_SEC;
+  cout << "  " << name << ": " << seconds / frames * 1e3 << " ms" << endl;
+}
+
+/// Times every Newton kernel this machine supports on the roots of
+/// z^degree - 1, in the Newton renderer's home view.
+static void bench_newton(int degree)
+{
+  View<double> view = { 64, 3.0, 0.0, 0.0, 1024, 1024, FORMULA_MULTIBROT, 2 };
+  Polynomial<double> poly;
+  poly.degree = degree;
+  for (int k = 0; k < degree; ++k) {
+    poly.rr[k] = cos(2 * 3.14159265358979323846 * k / degree);
+    poly.ri[k] = sin(2 * 3.14159265358979323846 * k / degree);
+  }
+  expand_roots(poly);
+  cout << "Newton, z^" << degree << " - 1, " << view.width << "x" << view.height
+       << ", limit " << view.limit << ", per frame" << endl;
+  for (int i = 0; i <= cpu_detect(); ++i) {
+    const KernelSet & kernels = kernels_for((Isa)i);
+    string name = isa_name((Isa)i);
+    bench_newton_rows<float>((name + " float").c_str(), kernels.newton_float,
+                             view_as<float>(view), polynomial_as<float>(poly));
+    bench_newton_rows<double>((name + " double").c_str(), kernels.newton_double, view, poly);
+  }
+}
+
+/// Times the widest row kernels on a frame of the view in every power, each
+/// against the z^2 baseline.
+static void bench_powers(const char * title, View<double> view)
+{
+  const KernelSet & kernels = kernels_for(cpu_detect());
+  cout << title << ", " << view.width << "x" << view.height << ", limit " << view.limit
+       << ", " << isa_name(kernels.isa) << ", per frame" << endl;
+  for (int p = MIN_POWER; p <= MAX_POWER; ++p) {
+    view.power = p;
+    string name = string("z^") + (char)('0' + p);
+    bench_rows<float>((name + " float").c_str(), kernels.row_float, view_as<float>(view));
+    bench_rows<double>((name + " double").c_str(), kernels.row_double, view);
+  }
+}
+
+/// Each formula in z^2, against the Multibrot loop.
+static void bench_formulas(const char * title, View<double> view)
+{
+  const KernelSet & kernels = kernels_for(cpu_detect());
+  cout << title << ", " << view.width << "x" << view.height << ", limit " << view.limit
+       << ", " << isa_name(kernels.isa) << ", per frame" << endl;
+  for (int f = 0; f < FORMULA_COUNT; ++f) {
+    view.formula = f;
+    string name = formula_name((Formula)f);
+    bench_rows<float>((name + " float").c_str(), kernels.row_float, view_as<float>(view));
+    bench_rows<double>((name + " double").c_str(), kernels.row_double, view);
+  }
+}
+
+/// Times each piece of a frame of the view, rows [r1, r2) of 32x32 tiles as
+/// in Mandelbrot, with the widest float kernel, in the order given.  Fills in
+/// the seconds of each piece.
+static void time_pieces(const View<float> & view, vector<TileWork> & work)
+{
+  const KernelSet & kernels = kernels_for(cpu_detect());
+  const int tile = 32, tiles_x = view.width / tile;
+  vector<int> counts(tile);
+  vector<float> norms(tile);
+  for (size_t i = 0; i < work.size(); ++i) {
+    int x1 = work[i].tile % tiles_x * tile, y1 = work[i].tile / tiles_x * tile;
+    double best = 1e9;
+    for (int run = 0; run < 3; ++run) {
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (int j = y1 + work[i].r1; j < y1 + work[i].r2; ++j)
+        kernels.row_float(view, j, x1, x1 + tile, &counts[0], &norms[0]);
+      best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    work[i].seconds = best;
+  }
+}
+
+/// Time a frame of the pieces takes on the given number of workers, each
+/// taking the next piece in order whenever it is free, over the ideal of all
+/// their time split evenly.
+static double makespan(const vector<TileWork> & work, int workers)
+{
+  vector<double> free_at(workers, 0.0);
+  double total = 0;
+  for (size_t i = 0; i < work.size(); ++i) {
+    *min_element(free_at.begin(), free_at.end()) += work[i].seconds;
+    total += work[i].seconds;
+  }
+  return *max_element(free_at.begin(), free_at.end()) / (total / workers);
+}
+
+/// 4 KB pages that each run of window pieces in a row writes to, on average:
+/// of data, in rows of BGR, and of counts, tile by tile in the layout's order.
+/// These are the pages the workers have in flight at once, and share the
+/// TLB and the caches between.
+static double pages_in_flight(const vector<TileWork> & work, const TileScheduler & layout,
+                              int window, int width)
+{
+  const int tile = 32, tiles_x = width / tile;
+  const long long counts = 1LL << 40;   /// Keeps the pages of counts apart
+  double total = 0;
+  int runs = 0;
+  for (size_t i = 0; i + window <= work.size(); i += window) {
+    set<long long> pages;
+    for (size_t k = i; k < i + window; ++k) {
+      const TileWork & p = work[k];
+      long long x1 = p.tile % tiles_x * tile, y1 = p.tile / tiles_x * tile;
+      for (long long j = y1 + p.r1; j < y1 + p.r2; ++j) {
+        pages.insert(3 * (j * width + x1) >> 12);
+        pages.insert((3 * (j * width + x1 + tile) - 1) >> 12);
+      }
+      long long first = (long long)layout.slot(p.tile) * tile * tile;
+      for (long long b = 4 * (first + p.r1 * tile) >> 12; b <= (4 * (first + p.r2 * tile) - 1) >> 12; ++b)
+        pages.insert(counts + b);
+    }
+    total += pages.size();
+    ++runs;
+  }
+  return runs ? total / runs : 0;
+}
+
+/// Frames of the view scheduled in every TileOrder, from the costs of the
+/// frame before (see TileScheduler), as the imbalance each would have on
+/// several numbers of workers, and the pages those workers would write to
+/// at once.  This machine may have fewer processors than that, so the pieces
+/// are timed one at a time and the workers simulated.
+static void bench_schedule(const char * title, const View<double> & view)
+{
+  View<float> view_float = view_as<float>(view);
+  vector<TileScheduler> schedulers;
+  for (int o = 0; o < ORDER_COUNT; ++o)
+    schedulers.push_back(TileScheduler(view.width / 32, view.height / 32, 32, (TileOrder)o));
+  vector<TileWork> first = schedulers[ORDER_ROWS].plan(1);
+  time_pieces(view_float, first);
+  for (int o = 0; o < ORDER_COUNT; ++o)
+    schedulers[o].record(first);
+  cout << title << ", " << view.width << "x" << view.height << ", limit " << view.limit
+       << ", frame time over ideal (pages in flight)" << endl;
+  int counts[] = { 4, 8, 16, 64 };
+  for (int i = 0; i < 4; ++i) {
+    cout << "  " << counts[i] << " workers:";
+    for (int o = 0; o < ORDER_COUNT; ++o) {
+      vector<TileWork> planned = schedulers[o].plan(counts[i]);
+      time_pieces(view_float, planned);
+      cout << (o ? ", " : " ") << order_name((TileOrder)o) << " " << makespan(planned, counts[i])
+           << " (" << pages_in_flight(planned, schedulers[o], counts[i], view.width) << ")";
+    }
+    cout << endl;
+  }
+}
+
+/// Read-modify-write bandwidth over a buffer well past the caches, every
+/// worker over its own slice, as with tiles placed for TileScheduler: with
+/// the buffer zeroed by the main thread first, as the renderers' buffers
+/// were, and by the slices' workers (see ThreadPool::first_touch()), each
+/// on a pool left to the OS and pinned.  Across NUMA nodes, first touch only
+/// pays with pinning, so that the workers stay on the node their slice is.
+static void bench_placement()
+{
+  vector<Processor> processors = cpu_topology();
+  cout << "Memory placement, ";
+  print_topology(processors);
+  const size_t bytes = (size_t)256 << 20;
+  for (int pinned = 0; pinned < 2; ++pinned) {
+    ThreadPool pool(cpu_count());
+    if (pinned)
+      pool.pin(processors);
+    for (int touch = 0; touch < 2; ++touch) {
+      /// Fresh pages: blocks this size are mapped on every allocation.
+      unsigned long long * buffer = new unsigned long long[bytes / 8];
+      if (touch)
+        pool.first_touch(buffer, bytes);
+      else
+        memset(buffer, 0, bytes);
+      double best = 1e9;
+      for (int run = 0; run < 5; ++run) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        size_t n = bytes / 8, workers = pool.size();
+        pool.on_each([buffer, n, workers](int i) {
+          for (size_t k = n * i / workers; k < n * (i + 1) / workers; ++k)
+            ++buffer[k];
+        });
+        best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+      }
+      cout << "  " << pool.size() << (pinned ? " pinned" : " unpinned") << " workers, placed by "
+           << (touch ? "their first touch: " : "the main thread: ") << 2 * bytes / best / 1e9
+           << " GB/s" << endl;
+      delete[] buffer;
+    }
+  }
+}
+
+/// Buddhabrot samples per second on 1, 2, 4, ... workers, up to twice the
+/// processors there are.  Past the processors the workers take turns, so the
+/// rate should hold steady there rather than grow, and falls by what each
+/// worker costs on top of its samples.
+static void bench_buddhabrot(const char * title, const View<double> & view, bool metropolis)
+{
+  cout << title << ", " << view.width << "x" << view.height << ", limit " << view.limit << ", "
+       << (metropolis ? "Metropolis-Hastings" : "uniform") << endl;
+  int processors = cpu_count();
+  for (int workers = 1; workers <= 2 * processors; workers *= 2) {
+    ThreadPool pool(workers);
+    BuddhabrotSampler sampler(view, workers);
+    sampler.place(pool);
+    sampler.reset(view, false, metropolis);
+    long samples, visible;
+    sampler.sample(pool);
+    sampler.take_counts(samples, visible);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double seconds;
+    do {
+      sampler.sample(pool);
+      seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (seconds < 1);
+    sampler.take_counts(samples, visible);
+    cout << "  " << workers << (workers == 1 ? " worker: " : " workers: ")
+         << samples / seconds / 1e6 << " million samples/s"
+         << (workers > processors ? ", sharing processors" : "") << endl;
+  }
+}
+
+int main()
+{
+  View<double> home = { 64, 3.0, -9 / 14.0, 0.0, 1024, 1024, FORMULA_MULTIBROT, 2 };
+  bench_views("Row kernels, home view", home);
+  home.limit = 1024;
+  bench_views("Row kernels, home view", home);
+  View<double> bulbs = { 1024, 0.25, -0.12, 0.75, 1024, 1024, FORMULA_MULTIBROT, 2 };
+  bench_views("Row kernels, period-3 bulb", bulbs);
+  View<double> whole = { 256, 3.0, 0.0, 0.0, 1024, 1024, FORMULA_MULTIBROT, 2 };
+  bench_powers("Multibrot z^p + c, whole set", whole);
+  View<double> folded = { 256, 3.5, -0.4, -0.5, 1024, 1024, FORMULA_MULTIBROT, 2 };
+  bench_formulas("Formulas, z^2", folded);
+  bench_distance("Distance estimation, home view", home);
+  View<double> seahorse = { 1024, 0.05, -0.745, 0.11, 1024, 1024, FORMULA_MULTIBROT, 2 };
+  bench_distance("Distance estimation, seahorse valley", seahorse);
+  bench_newton(3);
+  bench_newton(8);
+  bench_schedule("Tile scheduling, home view", home);
+  bench_schedule("Tile scheduling, period-3 bulb", bulbs);
+  bench_placement();
+  View<double> buddhabrot = { 512, 3.0, -0.5, 0.0, 1024, 1024, FORMULA_MULTIBROT, 2 };
+  bench_buddhabrot("Buddhabrot", buddhabrot, true);
+  bench_buddhabrot("Buddhabrot", buddhabrot, false);
+
+  cout << "Reference orbit, per iteration" << endl;
+  bench_orbit<long double>("long double");
+  bench_orbit<DoubleDouble>("double-double");
+  bench_orbit<Fixed128>("128-bit fixed");
+  bench_orbit<Fixed256>("256-bit fixed");
+  bench_orbit<Fixed1024>("1024-bit fixed");
+  return 0;
+}
@@ -0,0 +1,252 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Fixed-point numbers of N 32-bit limbs, for reference orbits deeper than
+/// double-double can go.  The number of limbs is a template parameter, so
+/// every loop has a constant trip count and the compiler unrolls it for each
+/// width (BigFixed<4> is 128 bits, BigFixed<8> 256, BigFixed<32> 1024).
+///
+/// Values are two's complement with 4 integer bits, i.e. in [-8, 8) with
+/// 32N - 4 fraction bits.  That is plenty for z^2 + c: the orbit stops as
+/// soon as |z| reaches 2, and every intermediate of mandelbrot_step() stays
+/// below 8.  Only addition wraps silently; do not square anything bigger.
+///
+/// Products are truncated: partial products that can only reach below the
+/// last bit through carries are skipped, which costs less than one unit in
+/// the last place.
+#pragma once
+#include <stdint.h>
+#include <cmath>
+#include "DoubleDouble.h"
+
+#if defined(__clang__)
+  #define BIGFIXED_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__) && __GNUC__ >= 8
+  #define BIGFIXED_UNROLL _Pragma("GCC unroll 64")
+#else
+  #define BIGFIXED_UNROLL
+#endif
+
+template <int N>
+struct BigFixed {
+  typedef char at_least_three_limbs[N >= 3 ? 1 : -1];
+  enum { limbs = N, fraction_bits = 32 * N - 4 };
+
+  uint32_t limb[N];       /// Least significant first
+
+  BigFixed() {
+    BIGFIXED_UNROLL
+    for (int k = 0; k < N; ++k)
+      limb[k] = 0;
+  }
+
+  BigFixed(double a) {
+    bool negative = a < 0;
+    /// Peel 32 bits at a time off |a| / 16, which is exact in double.
+    double t = std::fabs(a) / 16;
+    for (int k = N - 1; k >= 0; --k) {
+      t *= 4294967296.0;
+      double d = std::floor(t);
+      limb[k] = (uint32_t)d;
+      t -= d;
+    }
+    if (negative)
+      *this = -*this;
+  }
+
+  BigFixed(const DoubleDouble & a) {
+    *this = BigFixed(a.hi) + BigFixed(a.lo);
+  }
+
+  bool negative() const { return (limb[N - 1] >> 31) != 0; }
+
+  BigFixed operator-() const {
+    BigFixed r;
+    uint64_t carry = 1;
+    BIGFIXED_UNROLL
+    for (int k = 0; k < N; ++k) {
+      uint64_t t = (uint64_t)(~limb[k]) + carry;
+      r.limb[k] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    return r;
+  }
+
+  BigFixed operator+(const BigFixed & b) const {
+    BigFixed r;
+    uint64_t carry = 0;
+    BIGFIXED_UNROLL
+    for (int k = 0; k < N; ++k) {
+      uint64_t t = (uint64_t)limb[k] + b.limb[k] + carry;
+      r.limb[k] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    return r;
+  }
+
+  BigFixed operator-(const BigFixed & b) const {
+    BigFixed r;
+    uint64_t borrow = 0;
+    BIGFIXED_UNROLL
+    for (int k = 0; k < N; ++k) {
+      uint64_t t = (uint64_t)limb[k] - b.limb[k] - borrow;
+      r.limb[k] = (uint32_t)t;
+      borrow = (t >> 32) != 0;
+    }
+    return r;
+  }
+
+  BigFixed operator*(const BigFixed & b) const {
+    bool flip = negative() != b.negative();
+    BigFixed r = magnitude_product(negative() ? -*this : *this, b.negative() ? -b : b);
+    return flip ? -r : r;
+  }
+
+  BigFixed & operator+=(const BigFixed & b) { return *this = *this + b; }
+  BigFixed & operator-=(const BigFixed & b) { return *this = *this - b; }
+  BigFixed & operator*=(const BigFixed & b) { return *this = *this * b; }
+
+  bool operator==(const BigFixed & b) const {
+    BIGFIXED_UNROLL
+    for (int k = 0; k < N; ++k)
+      if (limb[k] != b.limb[k])
+        return false;
+    return true;
+  }
+
+  /// a * a, with each cross product computed once instead of twice.
+  BigFixed square() const {
+    const BigFixed a = negative() ? -*this : *this;
+    uint32_t p[2 * N + 1] = { 0 };
+    BIGFIXED_UNROLL
+    for (int i = 0; i < N - 1; ++i) {
+      uint64_t carry = 0;
+      BIGFIXED_UNROLL
+      for (int j = i + 1; j < N; ++j) {
+        if (i + j < N - 2)
+          continue;
+        uint64_t t = (uint64_t)a.limb[i] * a.limb[j] + p[i + j] + carry;
+        p[i + j] = (uint32_t)t;
+        carry = t >> 32;
+      }
+      p[i + N] = (uint32_t)carry;
+    }
+    BIGFIXED_UNROLL
+    for (int k = 2 * N - 1; k > 0; --k)
+      p[k] = (p[k] << 1) | (p[k - 1] >> 31);
+    p[0] <<= 1;
+    uint64_t carry = 0;
+    BIGFIXED_UNROLL
+    for (int i = 0; i < N; ++i) {
+      uint64_t sq = (uint64_t)a.limb[i] * a.limb[i];
+      uint64_t t = (uint64_t)p[2 * i] + (uint32_t)sq + carry;
+      p[2 * i] = (uint32_t)t;
+      t = (uint64_t)p[2 * i + 1] + (sq >> 32) + (t >> 32);
+      p[2 * i + 1] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    return shifted(p);
+  }
+
+  /// Same value with M limbs, dropping or padding the low end.
+  template <int M>
+  BigFixed<M> resize() const {
+    BigFixed<M> r;
+    for (int k = 0; k < M; ++k) {
+      int from = N - M + k;
+      r.limb[k] = from >= 0 ? limb[from] : 0;
+    }
+    return r;
+  }
+
+  /// Rounds to a floating point type, from the top three significant limbs.
+  template <class T>
+  T to() const {
+    /// Usually the top limb is significant; it carries the sign, and the
+    /// others only ever add to it.
+    int32_t top = (int32_t)limb[N - 1];
+    if (top != 0 && top != -1) {
+      const T limb_unit = T(1) / T(4294967296.0);
+      T r = (T)limb[N - 3] * limb_unit;
+      r = ((T)limb[N - 2] + r) * limb_unit;
+      return ((T)top + r) / T(268435456.0);
+    }
+    if (negative())
+      return -(-*this).template to<T>();
+    int k = N - 1;
+    while (k > 0 && limb[k] == 0)
+      --k;
+    T r = 0;
+    for (int i = k >= 2 ? k - 2 : 0; i <= k; ++i)
+      r += std::ldexp((T)limb[i], 32 * i - fraction_bits);
+    return r;
+  }
+
+private:
+  /// a * b for a, b >= 0.
+  static BigFixed magnitude_product(const BigFixed & a, const BigFixed & b) {
+    uint32_t p[2 * N + 1] = { 0 };
+    BIGFIXED_UNROLL
+    for (int i = 0; i < N; ++i) {
+      uint64_t carry = 0;
+      BIGFIXED_UNROLL
+      for (int j = 0; j < N; ++j) {
+        if (i + j < N - 2)
+          continue;
+        uint64_t t = (uint64_t)a.limb[i] * b.limb[j] + p[i + j] + carry;
+        p[i + j] = (uint32_t)t;
+        carry = t >> 32;
+      }
+      p[i + N] = (uint32_t)carry;
+    }
+    return shifted(p);
+  }
+
+  /// The double-width product p shifted back down by fraction_bits.
+  static BigFixed shifted(const uint32_t * p) {
+    BigFixed r;
+    BIGFIXED_UNROLL
+    for (int k = 0; k < N; ++k)
+      r.limb[k] = (p[k + N - 1] >> 28) | (p[k + N] << 4);
+    return r;
+  }
+};
+
+/// One step of z = z^2 + c.  2xy comes from (x + y)^2 - x^2 - y^2, so the
+/// step takes three squarings and no general multiplication.
+template <int N>
+static inline void mandelbrot_step(BigFixed<N> & x, BigFixed<N> & y,
+                                   const BigFixed<N> & cr, const BigFixed<N> & ci)
+{
+  BigFixed<N> xx = x.square();
+  BigFixed<N> yy = y.square();
+  BigFixed<N> ss = (x + y).square();
+  x = xx - yy + cr;
+  y = ss - xx - yy + ci;
+}
+
+template <int N>
+static inline double to_double(const BigFixed<N> & a)
+{
+  return a.template to<double>();
+}
+
+/// Conversions used by view_as().
+template <int N>
+static inline void convert(const BigFixed<N> & a, float & b) { b = (float)a.template to<double>(); }
+template <int N>
+static inline void convert(const BigFixed<N> & a, double & b) { b = a.template to<double>(); }
+template <int N>
+static inline void convert(const BigFixed<N> & a, long double & b) { b = a.template to<long double>(); }
+template <int N>
+static inline void convert(const BigFixed<N> & a, DoubleDouble & b)
+{
+  double hi = a.template to<double>();
+  b = DoubleDouble(hi, (a - BigFixed<N>(hi)).template to<double>());
+}
+template <int N, int M>
+static inline void convert(const BigFixed<N> & a, BigFixed<M> & b) { b = a.template resize<M>(); }
+
+typedef BigFixed<4> Fixed128;
+typedef BigFixed<8> Fixed256;
+typedef BigFixed<32> Fixed1024;   /// Deep enough for anything double deltas can resolve
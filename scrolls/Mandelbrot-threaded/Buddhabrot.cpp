@@ -0,0 +1,106 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <iostream>
+#include "Buddhabrot.h"
+using namespace std;
+
+Buddhabrot::Buddhabrot(int width, int height, int workers)
+  : TextureRenderer(width, height)
+{
+  this->view.limit = 512;
+  this->view.scale = 3.0;
+  this->view.cx = -0.5;
+  this->view.cy = 0.0;
+  this->view.width = width;
+  this->view.height = height;
+  this->view.formula = FORMULA_MULTIBROT;
+  this->view.power = 2;
+  this->view.julia = false;
+  this->view.jr = 0.0;
+  this->view.ji = 0.0;
+  this->nebulabrot = false;
+  this->metropolis = true;
+  this->workers = workers;
+  this->sampler = new BuddhabrotSampler(view, workers);
+  this->max_hits[0] = this->max_hits[1] = this->max_hits[2] = 0;
+  this->report_time = 0;
+}
+
+Buddhabrot::~Buddhabrot()
+{
+  delete sampler;
+}
+
+void Buddhabrot::compute_frame()
+{
+  sampler->sample(*pool);
+  sampler->brightest(max_hits);
+  const int band = BuddhabrotSampler::BAND_HEIGHT;
+  pool->parallel_for(0, (height + band - 1) / band, 1, [this, band](int b) {
+    int y1 = b * band, y2 = min(y1 + band, height);
+    colour_density(sampler->histogram() + 3 * y1 * width, width * (y2 - y1), max_hits,
+                   data + 3 * y1 * width);
+  });
+}
+
+void Buddhabrot::place_buffers()
+{
+  TextureRenderer::place_buffers();
+  sampler->place(*pool);
+}
+
+/// No tasks run here, so the counters and the histogram are safe to read and
+/// clear.
+void Buddhabrot::handle_inputs()
+{
+  TextureRenderer::handle_inputs();
+  report_time += elapsed_time;
+  if (report_time >= 1000) {
+    long samples, seen;
+    sampler->take_counts(samples, seen);
+    cout << samples * 1000 / report_time / 1e6 << " million samples/s on "
+         << workers << " workers, " << seen * 100.0 / samples << "% through the view ("
+         << (metropolis ? "Metropolis-Hastings" : "uniform") << ")" << endl;
+    report_time = 0;
+  }
+
+  View<double> last = view;
+  bool last_nebulabrot = nebulabrot, last_metropolis = metropolis;
+  if (glfwGetKey('H') == GLFW_PRESS) {
+    view.scale = 3.0;
+    view.cx = -0.5;
+    view.cy = 0.0;
+  }
+  double step = view.scale * 0.0625;
+  if (glfwGetKey('W') == GLFW_PRESS)
+    view.cy -= step;
+  if (glfwGetKey('A') == GLFW_PRESS)
+    view.cx += step;
+  if (glfwGetKey('S') == GLFW_PRESS)
+    view.cy += step;
+  if (glfwGetKey('D') == GLFW_PRESS)
+    view.cx -= step;
+  if (glfwGetKey('Q') == GLFW_PRESS)
+    view.scale *= 1.25;
+  if (glfwGetKey('E') == GLFW_PRESS)
+    view.scale *= 0.8;
+  if (glfwGetKey('[') == GLFW_PRESS && view.limit > BuddhabrotSampler::MIN_LIMIT)
+    view.limit /= 2;
+  if (glfwGetKey(']') == GLFW_PRESS && view.limit < BuddhabrotSampler::MAX_LIMIT)
+    view.limit *= 2;
+  if (glfwGetKey('N') == GLFW_PRESS)
+    nebulabrot = true;
+  if (glfwGetKey('B') == GLFW_PRESS)
+    nebulabrot = false;
+  if (glfwGetKey('M') == GLFW_PRESS)
+    metropolis = true;
+  if (glfwGetKey('U') == GLFW_PRESS)
+    metropolis = false;
+  if (view.scale < 1e-12)
+    view.scale = 1e-12;
+  if (view.scale > 16)
+    view.scale = 16;
+  view_changed = !same_view(view, last) || nebulabrot != last_nebulabrot
+                 || metropolis != last_metropolis;
+  if (view_changed)
+    sampler->reset(view, nebulabrot, metropolis);
+}
@@ -0,0 +1,48 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// The Buddhabrot: how often the orbits of points outside the Mandelbrot set
+/// pass through each pixel on their way out.
+#pragma once
+#include "TextureRenderer.h"
+#include "BuddhabrotSampler.h"
+#include "Colouring.h"
+
+/// Each frame, every worker takes a run of samples into the histogram (see
+/// BuddhabrotSampler), and then the histogram is coloured a band of rows per
+/// task.  The histogram keeps growing from frame to frame, so the image gets
+/// less noisy the longer the view stays.
+///
+///   - W, A, S, D pan, Q and E zoom, [ and ] change the iteration limit, and H
+///     goes back to the home view; each starts the histogram over.
+///   - N switches to the Nebulabrot, and B back to the Buddhabrot.
+///   - U switches to the uniform sampler, and M back to Metropolis-Hastings.
+///
+/// Samples per second are printed once a second, with how many of them
+/// reached the view.
+class Buddhabrot : public TextureRenderer
+{
+  View<double> view;           /// Iteration limit, zoom and centre of the renderer
+  bool nebulabrot;             /// Whether the channels have limits of their own
+  bool metropolis;             /// Whether to sample with Metropolis-Hastings
+  int workers;                 /// Number of workers, as passed to start_threaded()
+  BuddhabrotSampler * sampler; /// Histogram of the view so far
+  unsigned int max_hits[3];    /// Brightest pixel of the frame per channel, for colouring
+  double report_time;          /// Time since samples were last reported, in ms
+
+public:
+  /// Sets up the given number of workers; start it with start_threaded(workers).
+  Buddhabrot(int width, int height, int workers);
+  virtual ~Buddhabrot();
+
+private:
+  /// Samples and colours a frame.
+  void compute_frame();
+
+protected:
+  void handle_inputs();
+
+  /// Spreads the histogram over the workers, rather than leaving it all on
+  /// the main thread's node: every worker adds to all of it.
+  void place_buffers();
+};
@@ -0,0 +1,234 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include "BuddhabrotSampler.h"
+using namespace std;
+
+/// Share of the Metropolis-Hastings steps that draw a new point anywhere,
+/// rather than near the current one, so that the chain does not get stuck
+/// in one patch of the plane.
+static const double LARGE_MUTATION = 0.2;
+
+/// xorshift64*: the top 53 bits of the product make a double in [0, 1).
+static inline double uniform(unsigned long long & s)
+{
+  s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+  return (double)((s * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+BuddhabrotSampler::BuddhabrotSampler(const View<double> & view, int workers)
+{
+  this->width = view.width;
+  this->height = view.height;
+  this->workers = workers;
+  this->bands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+  this->state = new Worker[workers];
+  for (int i = 0; i < workers; ++i) {
+    Worker & w = state[i];
+    w.queue = new unsigned int[bands * QUEUE_SIZE];
+    w.queued = new int[bands];
+    w.orbit = new double[2 * MAX_LIMIT];
+    w.current = new double[2 * MAX_LIMIT];
+    w.rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+    w.samples = 0;
+    w.visible = 0;
+  }
+  this->band = new Band[bands];
+  this->hits = new unsigned int[3 * width * height];
+  start(view, false, true);
+}
+
+BuddhabrotSampler::~BuddhabrotSampler()
+{
+  for (int i = 0; i < workers; ++i) {
+    delete[] state[i].queue;
+    delete[] state[i].queued;
+    delete[] state[i].orbit;
+    delete[] state[i].current;
+  }
+  delete[] state;
+  delete[] band;
+  delete[] hits;
+}
+
+void BuddhabrotSampler::reset(const View<double> & view, bool nebulabrot, bool metropolis)
+{
+  start(view, nebulabrot, metropolis);
+  memset(hits, 0, 3 * width * height * sizeof(unsigned int));
+}
+
+void BuddhabrotSampler::start(const View<double> & view, bool nebulabrot, bool metropolis)
+{
+  this->view = view;
+  this->metropolis = metropolis;
+  limits[2] = view.limit;
+  limits[1] = nebulabrot ? max(view.limit / 10, 1) : view.limit;
+  limits[0] = nebulabrot ? max(view.limit / 100, 1) : view.limit;
+  for (int i = 0; i < workers; ++i) {
+    memset(state[i].queued, 0, bands * sizeof(int));
+    state[i].current_count = 0;
+  }
+  for (int b = 0; b < bands; ++b)
+    band[b].max[0] = band[b].max[1] = band[b].max[2] = 0;
+}
+
+void BuddhabrotSampler::sample(ThreadPool & pool)
+{
+  pool.parallel_for(0, workers, 1, [this](int i) {
+    Worker & worker = state[i];
+    if (metropolis)
+      sample_metropolis(worker);
+    else
+      sample_uniform(worker);
+    for (int b = 0; b < bands; ++b)
+      flush(worker, b);
+  });
+}
+
+void BuddhabrotSampler::brightest(unsigned int * max) const
+{
+  max[0] = max[1] = max[2] = 0;
+  for (int b = 0; b < bands; ++b)
+    for (int c = 0; c < 3; ++c)
+      max[c] = std::max(max[c], band[b].max[c]);
+}
+
+void BuddhabrotSampler::take_counts(long & samples, long & visible)
+{
+  samples = visible = 0;
+  for (int i = 0; i < workers; ++i) {
+    samples += state[i].samples;
+    visible += state[i].visible;
+    state[i].samples = state[i].visible = 0;
+  }
+}
+
+void BuddhabrotSampler::place(ThreadPool & pool)
+{
+  pool.first_touch(hits, 3 * width * height * sizeof(unsigned int));
+}
+
+int BuddhabrotSampler::trace(double cr, double ci, double * orbit)
+{
+  int limit = max(limits[0], max(limits[1], limits[2]));
+  double x = 0, y = 0, xx = 0, yy = 0;
+  for (int count = 1; count <= limit; ++count) {
+    y = 2 * x * y + ci;
+    x = xx - yy + cr;
+    xx = x * x;
+    yy = y * y;
+    orbit[2 * count - 2] = x;
+    orbit[2 * count - 1] = y;
+    if (xx + yy > 4)
+      return count;
+  }
+  return 0;
+}
+
+bool BuddhabrotSampler::visible(const double * orbit, int count)
+{
+  double half = 0.5 * view.scale;
+  for (int k = 0; k < count; ++k) {
+    if (fabs(orbit[2 * k] - view.cx) < half && fabs(orbit[2 * k + 1] - view.cy) < half)
+      return true;
+  }
+  return false;
+}
+
+void BuddhabrotSampler::splat(const double * orbit, int count, Worker & worker)
+{
+  double sx = width / view.scale, sy = height / view.scale;
+  double ox = width / 2 - view.cx * sx, oy = height / 2 - view.cy * sy;
+  unsigned int in = 0;
+  for (int c = 0; c < 3; ++c)
+    in |= (unsigned int)(count <= limits[c]) << c;
+  for (int k = 0; k < count; ++k) {
+    double px = orbit[2 * k] * sx + ox, py = orbit[2 * k + 1] * sy + oy;
+    if (px >= 0 && px < width && py >= 0 && py < height) {
+      int x = (int)px, y = (int)py, b = y / BAND_HEIGHT;
+      worker.queue[b * QUEUE_SIZE + worker.queued[b]] = (unsigned int)(y * width + x) << 3 | in;
+      if (++worker.queued[b] == QUEUE_SIZE)
+        flush(worker, b);
+    }
+  }
+}
+
+void BuddhabrotSampler::flush(Worker & worker, int b)
+{
+  const unsigned int * queue = worker.queue + b * QUEUE_SIZE;
+  int n = worker.queued[b];
+  if (n == 0)
+    return;
+  lock_guard<mutex> lock(band[b].mutex);
+  unsigned int * max = band[b].max;
+  for (int k = 0; k < n; ++k) {
+    unsigned int * pixel = hits + 3 * (queue[k] >> 3);
+    for (int c = 0; c < 3; ++c) {
+      pixel[c] += queue[k] >> c & 1;
+      if (pixel[c] > max[c]) max[c] = pixel[c];
+    }
+  }
+  worker.queued[b] = 0;
+}
+
+/// Points of c are drawn uniformly from the square |re|, |im| < 2, which holds
+/// the whole set; those in the main cardioid and period-2 bulb never escape,
+/// and are skipped without iterating.
+void BuddhabrotSampler::sample_uniform(Worker & worker)
+{
+  unsigned long long s = worker.rng;
+  for (int n = 0; n < SAMPLES_PER_FRAME; ++n) {
+    double cr = 4 * uniform(s) - 2, ci = 4 * uniform(s) - 2;
+    if (in_main_bulbs(cr, ci))
+      continue;
+    int count = trace(cr, ci, worker.orbit);
+    if (count && visible(worker.orbit, count)) {
+      splat(worker.orbit, count, worker);
+      ++worker.visible;
+    }
+  }
+  worker.rng = s;
+  worker.samples += SAMPLES_PER_FRAME;
+}
+
+/// The chain's target is uniform over the points of the square whose orbits
+/// escape and pass through the view, which is exactly the part of the uniform
+/// sampler's output that shows; so every point it visits counts with the same
+/// weight, and the image converges to the same one.
+///
+/// A step either draws a new point from the whole square, or moves the
+/// current one by up to a distance between 1e-4 and 1e-1 of the view, spread
+/// evenly on a log scale.  Both are symmetric, so a proposal is accepted
+/// whenever its orbit reaches the view.  Rejected or not, the current point
+/// is counted again, as Metropolis-Hastings has it.
+void BuddhabrotSampler::sample_metropolis(Worker & worker)
+{
+  unsigned long long s = worker.rng;
+  for (int n = 0; n < SAMPLES_PER_FRAME; ++n) {
+    double cr, ci;
+    if (worker.current_count == 0 || uniform(s) < LARGE_MUTATION) {
+      cr = 4 * uniform(s) - 2;
+      ci = 4 * uniform(s) - 2;
+    } else {
+      double r = view.scale * pow(10.0, -4 + 3 * uniform(s));
+      cr = worker.cr + r * (2 * uniform(s) - 1);
+      ci = worker.ci + r * (2 * uniform(s) - 1);
+    }
+    if (fabs(cr) < 2 && fabs(ci) < 2 && !in_main_bulbs(cr, ci)) {
+      int count = trace(cr, ci, worker.orbit);
+      if (count && visible(worker.orbit, count)) {
+        swap(worker.orbit, worker.current);
+        worker.current_count = count;
+        worker.cr = cr;
+        worker.ci = ci;
+      }
+    }
+    if (worker.current_count) {
+      splat(worker.current, worker.current_count, worker);
+      ++worker.visible;
+    }
+  }
+  worker.rng = s;
+  worker.samples += SAMPLES_PER_FRAME;
+}
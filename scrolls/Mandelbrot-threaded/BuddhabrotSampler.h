@@ -0,0 +1,135 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Sampling and binning for the Buddhabrot renderer.  Nothing here depends on
+/// OpenGL, so Benchmark can time it on any number of workers.
+#pragma once
+#include <mutex>
+#include "Kernels.h"
+#include "ThreadPool.h"
+
+/// How often the orbits of points outside the Mandelbrot set pass through
+/// each pixel on their way out, as a histogram of hits per pixel.
+///
+/// Orbits land anywhere in the frame, so a histogram per worker, merged once
+/// they finish, would cost a full-frame pass per worker per frame, and leave
+/// each worker's hits scattered over a histogram far larger than its caches.
+/// Instead the frame is cut into bands of rows, and each worker keeps a short
+/// queue of hits per band.  A full queue is added into the one shared
+/// histogram under its band's lock, so workers only contend when two flush
+/// the same band at once, and each flush stays within a band of rows.
+///
+/// Histograms keep a count per channel, blue, green and red, each with an
+/// iteration limit of its own: an orbit only counts towards the channels
+/// whose limit it escaped within.  With all three the same, the image is the
+/// grey Buddhabrot; the Nebulabrot gives red the full limit, green a tenth
+/// and blue a hundredth, so quick orbits come out white and slow ones red.
+///
+/// Zoomed in, almost no orbit from a uniformly drawn c passes through the
+/// view.  Each worker then runs a Metropolis-Hastings chain instead (see
+/// sample_metropolis()), which only ever moves to points whose orbits do.
+class BuddhabrotSampler
+{
+  /// What a worker writes to, on cache lines of its own so that workers never
+  /// write to the same line.
+  struct Worker {
+    unsigned int * queue;     /// QUEUE_SIZE hits per band, see flush()
+    int * queued;             /// Hits in each band's queue
+    double * orbit;           /// Orbit of the sample being traced, re and im interleaved
+    double * current;         /// Orbit of the chain's current point, for Metropolis-Hastings
+    int current_count;        /// Its length, or 0 while the chain has no point yet
+    double cr, ci;            /// The chain's current point
+    unsigned long long rng;   /// xorshift64* state
+    long samples;             /// Samples since the last report
+    long visible;             /// How many of them had an orbit through the view
+    char padding[64];
+  };
+
+  /// A band of rows of the histogram, on cache lines of its own.
+  struct Band {
+    std::mutex mutex;         /// Held while a queue is added in
+    unsigned int max[3];      /// Brightest pixel of the band per channel
+    char padding[64];
+  };
+
+  int width, height;
+  View<double> view;          /// Iteration limit, zoom and centre
+  bool metropolis;            /// Whether to sample with Metropolis-Hastings
+  int limits[3];              /// Iteration limit per channel, BGR
+  int workers;                /// Number of workers, as passed to the constructor
+  int bands;                  /// Bands of BAND_HEIGHT rows in the frame
+  Worker * state;             /// One per worker
+  Band * band;                /// One per band
+  unsigned int * hits;        /// The histogram, BGR per pixel in row order
+
+public:
+  /// Samples per worker per frame.
+  enum { SAMPLES_PER_FRAME = 1 << 14 };
+
+  /// Rows per band, when binning and colouring.
+  enum { BAND_HEIGHT = 16 };
+
+  /// Hits a worker queues per band before adding them in.
+  enum { QUEUE_SIZE = 256 };
+
+  /// Iteration limits the view may have; orbits are kept up to the largest.
+  enum { MIN_LIMIT = 16, MAX_LIMIT = 1 << 14 };
+
+  /// Sets up a histogram the size of the view, for up to width * height
+  /// < 2^29 pixels, and state for the given number of workers, to start on
+  /// the view with the Buddhabrot and Metropolis-Hastings.  The histogram is
+  /// only zeroed by place(), which must come before the first sample().
+  BuddhabrotSampler(const View<double> & view, int workers);
+  ~BuddhabrotSampler();
+
+  /// Starts the histogram over on the view, which must be the same size, with
+  /// the limit of each channel from view.limit for the Buddhabrot, or the
+  /// Nebulabrot, and with the Metropolis-Hastings or the uniform sampler.
+  void reset(const View<double> & view, bool nebulabrot, bool metropolis);
+
+  /// Takes SAMPLES_PER_FRAME samples per worker, one task per worker, and
+  /// adds their hits in.
+  void sample(ThreadPool & pool);
+
+  /// Histogram, 3 counts per pixel, BGR, in row order.
+  const unsigned int * histogram() const { return hits; }
+
+  /// Brightest pixel of the histogram so far, per channel.
+  void brightest(unsigned int * max) const;
+
+  /// Adds up the samples taken since the last call, and how many of them
+  /// had an orbit through the view.  Call it while no samples are taken.
+  void take_counts(long & samples, long & visible);
+
+  /// Zeroes the histogram, spread over the workers' nodes; see
+  /// ThreadPool::first_touch().
+  void place(ThreadPool & pool);
+
+private:
+  /// Sets the view, limits and sampler, and empties the queues and chains,
+  /// but leaves the histogram as it is.
+  void start(const View<double> & view, bool nebulabrot, bool metropolis);
+
+  /// Iterates z^2 + c from 0 into orbit, up to the largest of the limits.
+  /// Returns the number of iterations it took to escape, or 0 if it did not.
+  int trace(double cr, double ci, double * orbit);
+
+  /// Whether any point of the orbit falls inside the view.
+  bool visible(const double * orbit, int count);
+
+  /// Queues one hit for every point of the orbit in the view, to each
+  /// channel whose limit count is within.
+  void splat(const double * orbit, int count, Worker & worker);
+
+  /// Adds the hits the worker has queued for band b into the histogram.
+  /// Each hit is a pixel index, shifted left 3, with a bit per channel.
+  void flush(Worker & worker, int b);
+
+  /// Traces SAMPLES_PER_FRAME points drawn uniformly into the worker's
+  /// queues.
+  void sample_uniform(Worker & worker);
+
+  /// Takes SAMPLES_PER_FRAME steps of the worker's Metropolis-Hastings chain,
+  /// queueing its current point's orbit after each.
+  void sample_metropolis(Worker & worker);
+};
@@ -0,0 +1,100 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Turns the raw output of the kernels, escape counts and |Z|^2 at the escape
+/// (see RowKernel in Kernels.h), into texture colours.  Colouring only reads
+/// that output, so it can change without computing the fractal again.
+#pragma once
+#include <cmath>
+
+/// Ways to colour a frame.
+enum Colouring {
+  COLOURING_BANDS,        /// Escape count over the limit, in visible bands
+  COLOURING_SMOOTH,       /// Fractional escape count, from how far past 2 |Z| got
+  COLOURING_DISTANCE,     /// Estimated distance to the set (see DistanceKernel), as outlines
+  COLOURING_COUNT
+};
+
+/// Escape count of an escaped point of z^power + c with a fraction that takes
+/// out the bands:
+///
+///   count + 1 - log(log |Z|) / log(power)
+///
+/// A point that only just reached |Z| = 2 gets a little over count + 1, and
+/// one that overshot further gets less, down towards count.
+static inline float smooth_count(int count, float norm, int power)
+{
+  return count + 1 - std::log(0.5f * std::log(norm)) / std::log((float)power);
+}
+
+/// Pixels from the set over which COLOURING_DISTANCE fades to black.
+static const float OUTLINE_WIDTH = 4;
+
+/// Writes BGR colours for n pixels to bgr, tightly packed.  Points at the
+/// limit are black; the rest run from black to orange as their count nears it,
+/// or with COLOURING_DISTANCE, as they near the set.  distances is only read
+/// with COLOURING_DISTANCE.
+static inline void colour_pixels(const int * counts, const float * norms, const float * distances,
+                                 int n, int limit, int power, Colouring colouring,
+                                 unsigned char * bgr)
+{
+  for (int k = 0; k < n; ++k) {
+    unsigned char value = 0;
+    if (counts[k] < limit) {
+      float t;
+      if (colouring == COLOURING_DISTANCE)
+        t = (1 - distances[k] / OUTLINE_WIDTH) * limit;
+      else if (colouring == COLOURING_SMOOTH)
+        t = smooth_count(counts[k], norms[k], power);
+      else
+        t = counts[k];
+      t = t / (float)limit * 255;
+      value = t < 0 ? 0 : t > 255 ? 255 : (unsigned char)t;
+    }
+    bgr[3*k] = value;
+    bgr[3*k+1] = value >> 1;
+    bgr[3*k+2] = value >> 2;
+  }
+}
+
+/// Colours of the roots of a Newton fractal, BGR; roots past the eighth repeat.
+static const unsigned char ROOT_COLOURS[8][3] = {
+  {  64,  64, 255 }, {  64, 255,  64 }, { 255,  96,  64 }, {  64, 224, 255 },
+  { 255,  64, 224 }, { 255, 224,  64 }, { 160, 160, 160 }, {  64, 128, 255 }
+};
+
+/// Writes BGR colours for n pixels of a Newton fractal to bgr: the colour of
+/// the root each pixel converged to, darker the more steps it took.  Pixels
+/// that did not converge (root -1) are black.
+static inline void colour_roots(const int * counts, const int * roots, int n, int limit,
+                                unsigned char * bgr)
+{
+  for (int k = 0; k < n; ++k) {
+    if (roots[k] < 0) {
+      bgr[3*k] = bgr[3*k+1] = bgr[3*k+2] = 0;
+      continue;
+    }
+    const unsigned char * colour = ROOT_COLOURS[roots[k] % 8];
+    int shade = 256 - 256 * counts[k] / limit;
+    for (int c = 0; c < 3; ++c)
+      bgr[3*k+c] = (unsigned char)(colour[c] * shade >> 8);
+  }
+}
+
+/// Writes BGR colours for n pixels of a density histogram to bgr.  hits keeps
+/// a count per channel, BGR, and each channel gets the square root of its
+/// count over its max, so that the faint orbits stay visible next to the
+/// dense ones.  A channel stays black while its max is 0.
+static inline void colour_density(const unsigned int * hits, int n, const unsigned int * max,
+                                  unsigned char * bgr)
+{
+  float scale[3];
+  for (int c = 0; c < 3; ++c)
+    scale[c] = max[c] ? 1.0f / max[c] : 0.0f;
+  for (int k = 0; k < 3 * n; k += 3) {
+    for (int c = 0; c < 3; ++c) {
+      float t = std::sqrt(hits[k + c] * scale[c]) * 255;
+      bgr[k + c] = t > 255 ? 255 : (unsigned char)t;
+    }
+  }
+}
@@ -0,0 +1,271 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include "Cpu.h"
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#elif defined(__GNUC__)
+  #include <cpuid.h>
+#endif
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+#ifdef __linux__
+  #include <dirent.h>
+  #include <sched.h>
+#endif
+using namespace std;
+
+static const char * names[ISA_COUNT] = { "scalar", "sse2", "avx2", "avx512" };
+
+/// regs receives eax, ebx, ecx, edx of cpuid(leaf, subleaf).
+static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4])
+{
+#if defined(_MSC_VER)
+  __cpuidex((int *)regs, leaf, subleaf);
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/// Which register states the OS has enabled (XCR0).
+static unsigned long long xgetbv()
+{
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  unsigned int lo, hi;
+  __asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+  return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+Isa cpu_detect()
+{
+  unsigned int regs[4];
+  cpuid(0, 0, regs);
+  unsigned int max_leaf = regs[0];
+  if (max_leaf < 1)
+    return ISA_SCALAR;
+
+  cpuid(1, 0, regs);
+  bool sse2 = (regs[3] & (1 << 26)) != 0;
+  bool fma = (regs[2] & (1 << 12)) != 0;
+  bool osxsave = (regs[2] & (1 << 27)) != 0;
+  bool avx = (regs[2] & (1 << 28)) != 0;
+  if (!sse2)
+    return ISA_SCALAR;
+  if (!osxsave || !avx || max_leaf < 7)
+    return ISA_SSE2;
+
+  /// XMM and YMM state (bits 1, 2), then opmask and ZMM state (bits 5, 6, 7).
+  unsigned long long xcr0 = xgetbv();
+  if ((xcr0 & 0x6) != 0x6)
+    return ISA_SSE2;
+  cpuid(7, 0, regs);
+  bool avx2 = (regs[1] & (1 << 5)) != 0;
+  bool avx512f = (regs[1] & (1 << 16)) != 0;
+  if (!avx2 || !fma)
+    return ISA_SSE2;
+  if (!avx512f || (xcr0 & 0xe0) != 0xe0)
+    return ISA_AVX2;
+  return ISA_AVX512;
+}
+
+const char * isa_name(Isa isa)
+{
+  if (isa < 0 || isa >= ISA_COUNT)
+    return "unknown";
+  return names[isa];
+}
+
+Isa isa_parse(const char * name)
+{
+  for (int i = 0; i < ISA_COUNT; ++i)
+    if (strcmp(name, names[i]) == 0)
+      return (Isa)i;
+  return ISA_COUNT;
+}
+
+/// Reads two numbers from the start of a file; a word such as "max" reads
+/// as -1.  Returns how many it read.
+static int read_numbers(const char * path, long & a, long & b)
+{
+  FILE * f = fopen(path, "r");
+  if (!f)
+    return 0;
+  char word[32];
+  int n = 0;
+  for (long * x = &a; n < 2 && fscanf(f, "%31s", word) == 1; x = &b, ++n)
+    *x = word[0] == '-' || (word[0] >= '0' && word[0] <= '9') ? atol(word) : -1;
+  fclose(f);
+  return n;
+}
+
+/// Processors' worth of CPU time the cgroup of this process may use, rounded
+/// up, or 0 without a quota.  Containers see their own cgroup at the root of
+/// /sys/fs/cgroup: cgroup v2 keeps "quota period" in cpu.max, v1 keeps them
+/// in two files.
+static int cgroup_quota()
+{
+  long quota = -1, period = -1, unused;
+  if (read_numbers("/sys/fs/cgroup/cpu.max", quota, period) != 2) {
+    read_numbers("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", quota, unused);
+    read_numbers("/sys/fs/cgroup/cpu/cpu.cfs_period_us", period, unused);
+  }
+  if (quota <= 0 || period <= 0)
+    return 0;
+  return (int)((quota + period - 1) / period);
+}
+
+int cpu_count()
+{
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  int count = (int)info.dwNumberOfProcessors;
+#else
+  int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+#ifdef __linux__
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) < count)
+    count = CPU_COUNT(&set);
+  int quota = cgroup_quota();
+  if (quota > 0 && quota < count)
+    count = quota;
+#endif
+  return count > 0 ? count : 1;
+}
+
+#ifdef __linux__
+/// Reads a number from a sysfs file, or returns fallback.
+static int read_int(const char * path, int fallback)
+{
+  long a = fallback, b;
+  read_numbers(path, a, b);
+  return (int)a;
+}
+
+/// NUMA node of a processor: its sysfs directory links to it as nodeN.
+static int node_of(int id)
+{
+  char path[64];
+  sprintf(path, "/sys/devices/system/cpu/cpu%d", id);
+  DIR * dir = opendir(path);
+  if (!dir)
+    return 0;
+  int node = 0;
+  for (dirent * entry = readdir(dir); entry; entry = readdir(dir)) {
+    if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+      node = atoi(entry->d_name + 4);
+      break;
+    }
+  }
+  closedir(dir);
+  return node;
+}
+#endif
+
+/// Order to pin in: node, then how many threads of the same core come first,
+/// then where the core is.
+struct PinOrder {
+  const vector<int> & sibling;
+  PinOrder(const vector<int> & sibling) : sibling(sibling) {}
+  bool operator()(const Processor & a, const Processor & b) const {
+    if (a.node != b.node)
+      return a.node < b.node;
+    if (sibling[a.id] != sibling[b.id])
+      return sibling[a.id] < sibling[b.id];
+    if (a.package != b.package)
+      return a.package < b.package;
+    if (a.core != b.core)
+      return a.core < b.core;
+    return a.id < b.id;
+  }
+};
+
+vector<Processor> cpu_topology()
+{
+  vector<Processor> processors;
+#ifdef __linux__
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int id = 0; id < CPU_SETSIZE; ++id) {
+      if (!CPU_ISSET(id, &set))
+        continue;
+      char path[96];
+      Processor p = { id, 0, id, node_of(id) };
+      sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", id);
+      p.package = read_int(path, 0);
+      sprintf(path, "/sys/devices/system/cpu/cpu%d/topology/core_id", id);
+      p.core = read_int(path, id);
+      processors.push_back(p);
+    }
+  }
+#endif
+  if (processors.empty()) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int count = (int)info.dwNumberOfProcessors;
+#else
+    int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    for (int id = 0; id < count; ++id) {
+      Processor p = { id, 0, id, 0 };
+      processors.push_back(p);
+    }
+  }
+  int most = 0;
+  for (size_t i = 0; i < processors.size(); ++i)
+    most = max(most, processors[i].id + 1);
+  vector<int> sibling(most, 0);
+  for (size_t i = 0; i < processors.size(); ++i)
+    for (size_t j = 0; j < i; ++j)
+      if (processors[j].package == processors[i].package && processors[j].core == processors[i].core)
+        ++sibling[processors[i].id];
+  sort(processors.begin(), processors.end(), PinOrder(sibling));
+  return processors;
+}
+
+void print_topology(const vector<Processor> & processors)
+{
+  set<int> nodes, packages;
+  set<pair<int, int> > cores;
+  for (size_t i = 0; i < processors.size(); ++i) {
+    nodes.insert(processors[i].node);
+    packages.insert(processors[i].package);
+    cores.insert(make_pair(processors[i].package, processors[i].core));
+  }
+  cout << processors.size() << " logical processors on " << cores.size() << " cores, "
+       << packages.size() << (packages.size() == 1 ? " package, " : " packages, ")
+       << nodes.size() << (nodes.size() == 1 ? " NUMA node" : " NUMA nodes") << endl;
+  for (set<int>::iterator n = nodes.begin(); n != nodes.end(); ++n) {
+    cout << "  Node " << *n << ":";
+    for (size_t i = 0; i < processors.size(); ++i)
+      if (processors[i].node == *n)
+        cout << " " << processors[i].id;
+    cout << endl;
+  }
+}
+
+bool pin_thread(int id)
+{
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(id, &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+  return id < 64 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << id) != 0;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,54 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Works out which instruction sets the processor (and operating system)
+/// supports, so the widest kernel can be picked once at startup, and how many
+/// processors there are to run workers on, and where.
+#pragma once
+#include <vector>
+
+/// Instruction sets we have kernels for, narrowest first.
+enum Isa {
+  ISA_SCALAR,
+  ISA_SSE2,
+  ISA_AVX2,
+  ISA_AVX512,
+  ISA_COUNT
+};
+
+/// Widest instruction set this machine can run.  Uses cpuid, and checks with
+/// xgetbv that the OS saves the wider registers across context switches.
+Isa cpu_detect();
+
+/// Name of the instruction set, e.g. "avx2".
+const char * isa_name(Isa isa);
+
+/// Looks up an instruction set by name.  Returns ISA_COUNT if unknown.
+Isa isa_parse(const char * name);
+
+/// Number of logical processors this process can use, at least 1: those
+/// online, and on Linux, no more than its affinity mask allows or its cgroup
+/// CPU quota pays for.
+int cpu_count();
+
+/// Where a logical processor sits.
+struct Processor {
+  int id;        /// Number the OS knows it by
+  int package;   /// Socket
+  int core;      /// Physical core within the package
+  int node;      /// NUMA node whose memory is nearest
+};
+
+/// The logical processors this process may run on, in the order to pin
+/// workers to them: node by node, and within a node one thread of every core
+/// before the second of any, so that fewer workers than processors still get
+/// a core each.  Read from sysfs on Linux; elsewhere every processor counts
+/// as a core of its own on node 0.
+std::vector<Processor> cpu_topology();
+
+/// Prints how the processors split into nodes, packages and cores.
+void print_topology(const std::vector<Processor> & processors);
+
+/// Pins the calling thread to the logical processor with the given id.
+/// Returns false where the OS does not support or allow it.
+bool pin_thread(int id);
@@ -0,0 +1,136 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Double-double arithmetic: a number is the unevaluated sum hi + lo of two
+/// doubles, with |lo| <= ulp(hi) / 2, giving about 106 bits of mantissa.
+/// The algorithms are the usual error-free transformations (Dekker, Knuth),
+/// see Hida, Li and Bailey, "Library for Double-Double and Quad-Double
+/// Arithmetic".
+///
+/// The operators are static, so every translation unit gets its own copy.
+/// The Kernels*.cpp files are built with different instruction sets, and must
+/// not end up sharing one compiled version.
+#pragma once
+
+struct DoubleDouble {
+  double hi;
+  double lo;
+
+  DoubleDouble() : hi(0), lo(0) {}
+  DoubleDouble(double a) : hi(a), lo(0) {}
+  DoubleDouble(double hi, double lo) : hi(hi), lo(lo) {}
+};
+
+/// a + b = s + e exactly, for any a and b.
+static inline double dd_two_sum(double a, double b, double & e)
+{
+  double s = a + b;
+  double bb = s - a;
+  e = (a - (s - bb)) + (b - bb);
+  return s;
+}
+
+/// a + b = s + e exactly, provided |a| >= |b|.
+static inline double dd_quick_two_sum(double a, double b, double & e)
+{
+  double s = a + b;
+  e = b - (s - a);
+  return s;
+}
+
+/// a * b = p + e exactly, by splitting each factor into 26-bit halves.
+static inline double dd_two_prod(double a, double b, double & e)
+{
+  double p = a * b;
+  double t = 134217729.0 * a;
+  double ah = t - (t - a);
+  double al = a - ah;
+  t = 134217729.0 * b;
+  double bh = t - (t - b);
+  double bl = b - bh;
+  e = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+  return p;
+}
+
+static inline DoubleDouble operator+(const DoubleDouble & a, const DoubleDouble & b)
+{
+  double e;
+  double s = dd_two_sum(a.hi, b.hi, e);
+  e += a.lo + b.lo;
+  s = dd_quick_two_sum(s, e, e);
+  return DoubleDouble(s, e);
+}
+
+static inline DoubleDouble operator-(const DoubleDouble & a)
+{
+  return DoubleDouble(-a.hi, -a.lo);
+}
+
+static inline DoubleDouble operator-(const DoubleDouble & a, const DoubleDouble & b)
+{
+  return a + (-b);
+}
+
+static inline DoubleDouble operator*(const DoubleDouble & a, const DoubleDouble & b)
+{
+  double e;
+  double p = dd_two_prod(a.hi, b.hi, e);
+  e += a.hi * b.lo + a.lo * b.hi;
+  p = dd_quick_two_sum(p, e, e);
+  return DoubleDouble(p, e);
+}
+
+static inline DoubleDouble operator/(const DoubleDouble & a, const DoubleDouble & b)
+{
+  double q1 = a.hi / b.hi;
+  DoubleDouble r = a - b * q1;
+  double q2 = r.hi / b.hi;
+  r = r - b * q2;
+  double q3 = r.hi / b.hi;
+  double e;
+  q1 = dd_quick_two_sum(q1, q2, e);
+  return DoubleDouble(q1, e) + q3;
+}
+
+static inline DoubleDouble & operator+=(DoubleDouble & a, const DoubleDouble & b)
+{
+  return a = a + b;
+}
+
+static inline DoubleDouble & operator-=(DoubleDouble & a, const DoubleDouble & b)
+{
+  return a = a - b;
+}
+
+static inline DoubleDouble & operator*=(DoubleDouble & a, const DoubleDouble & b)
+{
+  return a = a * b;
+}
+
+static inline bool operator<(const DoubleDouble & a, const DoubleDouble & b)
+{
+  return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+static inline bool operator==(const DoubleDouble & a, const DoubleDouble & b)
+{
+  return a.hi == b.hi && a.lo == b.lo;
+}
+
+static inline DoubleDouble dd_abs(const DoubleDouble & a)
+{
+  return a.hi < 0 ? -a : a;
+}
+
+/// Rounds to another type, for view_as().  long double gets both halves, so
+/// it keeps as many bits as it can hold.
+template <class T>
+static inline void convert(const DoubleDouble & a, T & b)
+{
+  b = (T)a.hi + (T)a.lo;
+}
+
+static inline double to_double(const DoubleDouble & a)
+{
+  return a.hi + a.lo;
+}
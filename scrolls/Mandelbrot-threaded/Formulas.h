@@ -0,0 +1,130 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Escape-time formulas, as policies the kernels are templated on.  Nothing
+/// here needs more than plain arithmetic, so the CUDA renderer includes this
+/// too and steps its orbits with the very same code.
+#pragma once
+
+/// Marks what may be called from CUDA kernels as well as from the host.
+#ifdef __CUDACC__
+  #define FORMULA_CALL __host__ __device__
+#else
+  #define FORMULA_CALL
+#endif
+
+/// Powers the kernels come in.
+enum { MIN_POWER = 2, MAX_POWER = 8 };
+
+/// Escape-time formulas the kernels come in, each in every power.
+enum Formula {
+  FORMULA_MULTIBROT,      /// z^power + c: the Mandelbrot set and the Multibrots
+  FORMULA_MULTICORN,      /// conj(z)^power + c: the Tricorn and its kin
+  FORMULA_BURNING_SHIP,   /// (|x| + i|y|)^power + c
+  FORMULA_COUNT
+};
+
+/// Plain arithmetic under the names of the wrappers in Simd.h, so templates
+/// written against those also work one number at a time.
+template <class T>
+struct Scalar {
+  typedef T V;
+  static FORMULA_CALL V add(const V & a, const V & b) { return a + b; }
+  static FORMULA_CALL V sub(const V & a, const V & b) { return a - b; }
+  static FORMULA_CALL V mul(const V & a, const V & b) { return a * b; }
+  static FORMULA_CALL V div(const V & a, const V & b) { return a / b; }
+  static FORMULA_CALL V fmadd(const V & a, const V & b, const V & c) { return a * b + c; }
+  static FORMULA_CALL V fmsub(const V & a, const V & b, const V & c) { return a * b - c; }
+  static FORMULA_CALL V abs(const V & a) { return a < V(0) ? -a : a; }
+};
+
+/// (rx, ry) = (x, y)^Power, squaring where the power is even and multiplying
+/// by z once where it is odd, so each power unrolls at compile time into a
+/// short fixed chain: z^4 = (z^2)^2, z^5 = z^4 z, z^8 = ((z^2)^2)^2.  S is a
+/// wrapper from Simd.h, or Scalar.
+template <class S, int Power>
+struct ComplexPower {
+  typedef typename S::V V;
+  static FORMULA_CALL void apply(const V & x, const V & y, V & rx, V & ry) {
+    V a, b;
+    if (Power % 2 == 0) {
+      ComplexPower<S, Power / 2>::apply(x, y, a, b);
+      V ab = S::mul(a, b);
+      rx = S::fmsub(a, a, S::mul(b, b));
+      ry = S::add(ab, ab);
+    } else {
+      ComplexPower<S, Power - 1>::apply(x, y, a, b);
+      rx = S::fmsub(a, x, S::mul(b, y));
+      ry = S::fmadd(a, y, S::mul(b, x));
+    }
+  }
+};
+
+template <class S>
+struct ComplexPower<S, 1> {
+  typedef typename S::V V;
+  static FORMULA_CALL void apply(const V & x, const V & y, V & rx, V & ry) {
+    rx = x;
+    ry = y;
+  }
+};
+
+/// Formulas, as policies for the kernel templates.  Each one steps an orbit
+/// with step(), written against the wrappers in Simd.h so the same inner loop
+/// compiles to scalar, SIMD or CUDA code with no call in it:
+///
+///   (x, y) = f(x, y) + (cr, ci)
+///
+/// and says whether in_main_bulbs() holds for its Mandelbrot-style set.
+/// Escape is at |Z| = 2 for all of them, and |f(Z)| = |Z|^Power, so smooth
+/// colouring works the same.
+template <int Power>
+struct Multibrot {
+  enum { power = Power, main_bulbs = Power == 2 };
+  template <class S>
+  static FORMULA_CALL void step(typename S::V & x, typename S::V & y,
+                   const typename S::V & cr, const typename S::V & ci) {
+    typedef typename S::V V;
+    if (Power == 2) {
+      V yy = S::mul(y, y);
+      y = S::fmadd(S::add(x, x), y, ci);
+      x = S::add(S::fmsub(x, x, yy), cr);
+    } else {
+      V zx, zy;
+      ComplexPower<S, Power>::apply(x, y, zx, zy);
+      x = S::add(zx, cr);
+      y = S::add(zy, ci);
+    }
+  }
+};
+
+/// conj(z)^Power + c.  conj(z)^n = conj(z^n), so only the sign of the
+/// imaginary part changes.
+template <int Power>
+struct Multicorn {
+  enum { power = Power, main_bulbs = 0 };
+  template <class S>
+  static FORMULA_CALL void step(typename S::V & x, typename S::V & y,
+                   const typename S::V & cr, const typename S::V & ci) {
+    typedef typename S::V V;
+    V zx, zy;
+    ComplexPower<S, Power>::apply(x, y, zx, zy);
+    x = S::add(zx, cr);
+    y = S::sub(ci, zy);
+  }
+};
+
+/// (|x| + i|y|)^Power + c, the Burning Ship for Power 2.
+template <int Power>
+struct BurningShip {
+  enum { power = Power, main_bulbs = 0 };
+  template <class S>
+  static FORMULA_CALL void step(typename S::V & x, typename S::V & y,
+                   const typename S::V & cr, const typename S::V & ci) {
+    typedef typename S::V V;
+    V zx, zy;
+    ComplexPower<S, Power>::apply(S::abs(x), S::abs(y), zx, zy);
+    x = S::add(zx, cr);
+    y = S::add(zy, ci);
+  }
+};
@@ -0,0 +1,77 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <iostream>
+#include <cmath>
+#include "Julia.h"
+using namespace std;
+
+Julia::Julia(int width, int height, const KernelSet & kernels, TileOrder order)
+  : Mandelbrot(width, height, kernels, false, false, order)
+{
+  this->view.julia = true;
+  this->view.jr = -0.8;
+  this->view.ji = 0.156;
+  this->frames = 0;
+  this->frame_time = 0;
+  frame_home();
+  update_view();
+}
+
+bool Julia::view_input()
+{
+  return Mandelbrot::view_input()
+         || glfwGetMouseButton(GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS
+         || glfwGetKey(GLFW_KEY_LEFT) == GLFW_PRESS || glfwGetKey(GLFW_KEY_RIGHT) == GLFW_PRESS
+         || glfwGetKey(GLFW_KEY_DOWN) == GLFW_PRESS || glfwGetKey(GLFW_KEY_UP) == GLFW_PRESS;
+}
+
+void Julia::frame_home()
+{
+  view.scale = 4.0;
+  view.cx = 0.0;
+  view.cy = 0.0;
+}
+
+void Julia::handle_inputs()
+{
+  double jr = to_double(view.jr);
+  double ji = to_double(view.ji);
+  if (glfwGetMouseButton(GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+    int mx, my;
+    glfwGetMousePos(&mx, &my);
+    /// Rows of the texture count up from the bottom of the window, the mouse
+    /// down from the top.
+    jr = -0.5 + (mx - width / 2) * (3.0 / width);
+    ji = (height - 1 - my - height / 2) * (3.0 / height);
+  }
+  const double nudge = 0.001;
+  if (glfwGetKey(GLFW_KEY_LEFT) == GLFW_PRESS)
+    jr -= nudge;
+  if (glfwGetKey(GLFW_KEY_RIGHT) == GLFW_PRESS)
+    jr += nudge;
+  if (glfwGetKey(GLFW_KEY_DOWN) == GLFW_PRESS)
+    ji -= nudge;
+  if (glfwGetKey(GLFW_KEY_UP) == GLFW_PRESS)
+    ji += nudge;
+  /// With |c| <= 2, an orbit past |Z| = 2 still escapes for certain.
+  double r = sqrt(jr*jr + ji*ji);
+  if (r > 2) {
+    jr *= 2 / r;
+    ji *= 2 / r;
+  }
+  bool moved = jr != to_double(view.jr) || ji != to_double(view.ji);
+  view.jr = jr;
+  view.ji = ji;
+  Mandelbrot::handle_inputs();
+  if (moved)
+    view_changed = true;
+
+  frame_time += elapsed_time;
+  if (finished)
+    ++frames;
+  if (frame_time >= 1000) {
+    cout << frames * 1000 / frame_time << " fps at c = " << jr
+         << (ji < 0 ? " - " : " + ") << fabs(ji) << "i" << endl;
+    frames = 0;
+    frame_time = 0;
+  }
+}
@@ -0,0 +1,38 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Julia sets on the Mandelbrot renderer: the same kernels, threads and
+/// colouring, with Z starting at the pixel and c held fixed (see View::julia).
+#pragma once
+#include "Mandelbrot.h"
+
+/// Julia set of the formula of the view, for a c that moves while it renders.
+///
+///   - Drag with the left mouse button to move c.  The window stands for the
+///     home view of the Mandelbrot set, so c is the point under the pointer
+///     there.
+///   - Arrow keys nudge c by a thousandth.
+///
+/// Everything else works as in Mandelbrot, but H frames the Julia set rather
+/// than the Mandelbrot set's home view.  While c moves every frame is
+/// computed from scratch, so it always takes the cheapest precision and the
+/// widest kernels.  Frames per second are printed once a second.
+class Julia : public Mandelbrot
+{
+  int frames;               /// Frames since the last report
+  double frame_time;        /// Their total time, in ms
+
+public:
+  /// Starts at c = -0.8 + 0.156i in the home view, with tiles in the given order.
+  Julia(int width, int height, const KernelSet & kernels, TileOrder order);
+
+protected:
+  void handle_inputs();
+
+  /// Also whether c is being dragged or nudged.
+  bool view_input();
+
+  /// Centres the view on 0, with all of |Z| <= 2 in the frame, where any
+  /// Julia set with |c| <= 2 lies.
+  void frame_home();
+};
@@ -0,0 +1,625 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <cfloat>
+#include <cmath>
+#include "Kernels.h"
+#include "BigFixed.h"
+
+/// row_scalar() for one formula, of its Mandelbrot-style set, or with Julia
+/// set, of the Julia set of c = (view.jr, view.ji).
+template <class T, class Formula, bool Julia>
+static int formula_scalar(const View<T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  T dx = view.scale / T(view.width);
+  T py = view.cy + T(j - view.height / 2) * (view.scale / T(view.height));
+  T ci = Julia ? view.ji : py;
+  T tolerance = periodicity_tolerance(T());
+  int warmup = periodicity_warmup(view.limit);
+  int saved = 0;
+  /// The check nearly doubles the cost of an iteration, so it only runs after
+  /// a pixel that reached the limit, as interior pixels come in runs.
+  bool check = true;
+  for (int p = x1; p < x2; ++p) {
+    T px = view.cx + T(p - view.width / 2) * dx;
+    T cr = Julia ? view.jr : px;
+    if (Formula::main_bulbs && !Julia && in_main_bulbs(cr, ci)) {
+      counts[p - x1] = view.limit;
+      norms[p - x1] = 0;
+      check = true;
+      continue;
+    }
+    T x = Julia ? px : T(0);
+    T y = Julia ? py : T(0);
+    T sx = x, sy = y;     /// Point saved for the periodicity check
+    int i = 0;
+    while ((x*x + y*y < T(4)) && (i++ < view.limit)) {
+        Formula::template step<Scalar<T> >(x, y, cr, ci);
+        if (!check || i < warmup)
+          continue;
+        int steps = i - warmup;
+        T ex = x - sx;
+        T ey = y - sy;
+        if (steps > 0 && ex*ex + ey*ey < tolerance) {
+          saved += view.limit - i;
+          i = view.limit;
+          break;
+        }
+        /// Brent's method: save Z at 0, 1, 2, 4, 8, ... steps past the warmup.
+        if (steps == (steps & -steps)) {
+          sx = x;
+          sy = y;
+        }
+    }
+    counts[p - x1] = i < view.limit ? i : view.limit;
+    norms[p - x1] = i < view.limit ? norm_of(x, y) : 0;
+    check = i >= view.limit;
+  }
+  return saved;
+}
+
+template <class T, class Formula>
+static int scalar_for_formula(const View<T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  if (view.julia)
+    return formula_scalar<T, Formula, true>(view, j, x1, x2, counts, norms);
+  return formula_scalar<T, Formula, false>(view, j, x1, x2, counts, norms);
+}
+
+template <class T, template <int> class Formula>
+static int scalar_for_power(const View<T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  switch (view.power) {
+  case 3:
+    return scalar_for_formula<T, Formula<3> >(view, j, x1, x2, counts, norms);
+  case 4:
+    return scalar_for_formula<T, Formula<4> >(view, j, x1, x2, counts, norms);
+  case 5:
+    return scalar_for_formula<T, Formula<5> >(view, j, x1, x2, counts, norms);
+  case 6:
+    return scalar_for_formula<T, Formula<6> >(view, j, x1, x2, counts, norms);
+  case 7:
+    return scalar_for_formula<T, Formula<7> >(view, j, x1, x2, counts, norms);
+  case 8:
+    return scalar_for_formula<T, Formula<8> >(view, j, x1, x2, counts, norms);
+  default:
+    return scalar_for_formula<T, Formula<2> >(view, j, x1, x2, counts, norms);
+  }
+}
+
+template <class T>
+int row_scalar(const View<T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  switch (view.formula) {
+  case FORMULA_MULTICORN:
+    return scalar_for_power<T, Multicorn>(view, j, x1, x2, counts, norms);
+  case FORMULA_BURNING_SHIP:
+    return scalar_for_power<T, BurningShip>(view, j, x1, x2, counts, norms);
+  default:
+    return scalar_for_power<T, Multibrot>(view, j, x1, x2, counts, norms);
+  }
+}
+
+template int row_scalar<float>(const View<float> &, int, int, int, int *, float *);
+template int row_scalar<double>(const View<double> &, int, int, int, int *, float *);
+template int row_scalar<long double>(const View<long double> &, int, int, int, int *, float *);
+template int row_scalar<DoubleDouble>(const View<DoubleDouble> &, int, int, int, int *, float *);
+
+/// row_distance_scalar() for one power of the Multibrot formula, or with Julia
+/// set, of its Julia set.  The orbit is formula_scalar()'s, step for step.
+template <class T, int Power, bool Julia>
+static int distance_scalar(const View<T> & view, int j, int x1, int x2, int * counts, float * norms,
+                           float * distances)
+{
+  T dx = view.scale / T(view.width);
+  T py = view.cy + T(j - view.height / 2) * (view.scale / T(view.height));
+  T ci = Julia ? view.ji : py;
+  T tolerance = periodicity_tolerance(T());
+  int warmup = periodicity_warmup(view.limit);
+  int saved = 0;
+  bool check = true;
+  for (int p = x1; p < x2; ++p) {
+    T px = view.cx + T(p - view.width / 2) * dx;
+    T cr = Julia ? view.jr : px;
+    distances[p - x1] = 0;
+    if (Power == 2 && !Julia && in_main_bulbs(cr, ci)) {
+      counts[p - x1] = view.limit;
+      norms[p - x1] = 0;
+      check = true;
+      continue;
+    }
+    T x = Julia ? px : T(0);
+    T y = Julia ? py : T(0);
+    /// dZ_0 is 1 pixel for Julia sets, where Z_0 is the pixel, and 0 otherwise.
+    T dr = Julia ? dx : T(0);
+    T di = T(0);
+    T sx = x, sy = y;
+    int i = 0;
+    while ((x*x + y*y < T(4)) && (i++ < view.limit)) {
+        /// dZ' = Power Z^(Power-1) dZ, plus 1 pixel for the Mandelbrot set.
+        T zx, zy;
+        ComplexPower<Scalar<T>, Power - 1>::apply(x, y, zx, zy);
+        T tr = zx * dr - zy * di;
+        di = T(Power) * (zx * di + zy * dr);
+        dr = Julia ? T(Power) * tr : T(Power) * tr + dx;
+        Multibrot<Power>::template step<Scalar<T> >(x, y, cr, ci);
+        if (!check || i < warmup)
+          continue;
+        int steps = i - warmup;
+        T ex = x - sx;
+        T ey = y - sy;
+        if (steps > 0 && ex*ex + ey*ey < tolerance) {
+          saved += view.limit - i;
+          i = view.limit;
+          break;
+        }
+        if (steps == (steps & -steps)) {
+          sx = x;
+          sy = y;
+        }
+    }
+    counts[p - x1] = i < view.limit ? i : view.limit;
+    norms[p - x1] = i < view.limit ? norm_of(x, y) : 0;
+    if (i < view.limit)
+      distances[p - x1] = distance_estimate(norms[p - x1], norm_of(dr, di));
+    check = i >= view.limit;
+  }
+  return saved;
+}
+
+template <class T, int Power>
+static int distance_for_power(const View<T> & view, int j, int x1, int x2, int * counts,
+                              float * norms, float * distances)
+{
+  if (view.julia)
+    return distance_scalar<T, Power, true>(view, j, x1, x2, counts, norms, distances);
+  return distance_scalar<T, Power, false>(view, j, x1, x2, counts, norms, distances);
+}
+
+template <class T>
+int row_distance_scalar(const View<T> & view, int j, int x1, int x2, int * counts, float * norms,
+                        float * distances)
+{
+  if (view.formula != FORMULA_MULTIBROT) {
+    for (int p = x1; p < x2; ++p)
+      distances[p - x1] = 0;
+    return row_scalar(view, j, x1, x2, counts, norms);
+  }
+  switch (view.power) {
+  case 3:
+    return distance_for_power<T, 3>(view, j, x1, x2, counts, norms, distances);
+  case 4:
+    return distance_for_power<T, 4>(view, j, x1, x2, counts, norms, distances);
+  case 5:
+    return distance_for_power<T, 5>(view, j, x1, x2, counts, norms, distances);
+  case 6:
+    return distance_for_power<T, 6>(view, j, x1, x2, counts, norms, distances);
+  case 7:
+    return distance_for_power<T, 7>(view, j, x1, x2, counts, norms, distances);
+  case 8:
+    return distance_for_power<T, 8>(view, j, x1, x2, counts, norms, distances);
+  default:
+    return distance_for_power<T, 2>(view, j, x1, x2, counts, norms, distances);
+  }
+}
+
+template int row_distance_scalar<float>(const View<float> &, int, int, int, int *, float *, float *);
+template int row_distance_scalar<double>(const View<double> &, int, int, int, int *, float *, float *);
+template int row_distance_scalar<long double>(const View<long double> &, int, int, int, int *, float *,
+                                              float *);
+template int row_distance_scalar<DoubleDouble>(const View<DoubleDouble> &, int, int, int, int *, float *,
+                                               float *);
+
+template <class T>
+int row_deferred(const View<T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  if (view.formula != FORMULA_MULTIBROT || view.power != 2 || view.julia)
+    return row_scalar(view, j, x1, x2, counts, norms);
+  T dx = view.scale / T(view.width);
+  T ci = view.cy + T(j - view.height / 2) * (view.scale / T(view.height));
+  T tolerance = periodicity_tolerance(T());
+  int warmup = periodicity_warmup(view.limit);
+  int saved = 0;
+  int first = view.limit < BAILOUT_DEFERRAL ? view.limit : BAILOUT_DEFERRAL;
+  /// Z after step k of the block, re and im.
+  T zx[BAILOUT_DEFERRAL + 1], zy[BAILOUT_DEFERRAL + 1];
+  for (int p = x1; p < x2; ++p) {
+    T cr = view.cx + T(p - view.width / 2) * dx;
+    if (in_main_bulbs(cr, ci)) {
+      counts[p - x1] = view.limit;
+      norms[p - x1] = 0;
+      continue;
+    }
+    /// Z_1 is c itself, exactly.
+    T x = cr, y = ci;
+    T sx = 0, sy = 0;
+    int i = 1;
+    int blocks = 0;
+    /// One iteration at a time at first, as most escaping pixels are out
+    /// within a block, and would only have it searched.
+    while (x*x + y*y < T(4) && i < first) {
+      T tmp = x*x - y*y + cr;
+      y = T(2) * x * y + ci;
+      x = tmp;
+      ++i;
+    }
+    bool escaped = !(x*x + y*y < T(4));
+    while (!escaped && i < view.limit) {
+      int n = view.limit - i < BAILOUT_DEFERRAL ? view.limit - i : BAILOUT_DEFERRAL;
+      for (int k = 1; k <= n; ++k) {
+        T tmp = x*x - y*y + cr;
+        y = T(2) * x * y + ci;
+        x = tmp;
+        zx[k] = x;
+        zy[k] = y;
+      }
+      if (!(x*x + y*y < T(4))) {
+        /// Escaped within the block: find the step it first went out at.
+        int k = 1;
+        while (zx[k]*zx[k] + zy[k]*zy[k] < T(4))
+          ++k;
+        x = zx[k];
+        y = zy[k];
+        i += k;
+        escaped = true;
+        break;
+      }
+      i += n;
+      if (i < warmup)
+        continue;
+      /// Brent's method once a block, as in row_interleaved().
+      int b = blocks++;
+      T ex = x - sx;
+      T ey = y - sy;
+      if (b > 0 && ex*ex + ey*ey < tolerance) {
+        saved += view.limit - i;
+        i = view.limit;
+        break;
+      }
+      if (b == (b & -b)) {
+        sx = x;
+        sy = y;
+      }
+    }
+    counts[p - x1] = escaped ? i : view.limit;
+    norms[p - x1] = escaped && i < view.limit ? norm_of(x, y) : 0;
+  }
+  return saved;
+}
+
+template int row_deferred<float>(const View<float> &, int, int, int, int *, float *);
+template int row_deferred<double>(const View<double> &, int, int, int, int *, float *);
+template int row_deferred<long double>(const View<long double> &, int, int, int, int *, float *);
+template int row_deferred<DoubleDouble>(const View<DoubleDouble> &, int, int, int, int *, float *);
+
+/// refill() is too big for the compilers to inline four times over on their
+/// own, and called as a function it leaves the lanes in memory rather than in
+/// registers.
+#if defined(_MSC_VER)
+  #define INTERLEAVED_INLINE __forceinline
+#elif defined(__GNUC__)
+  #define INTERLEAVED_INLINE inline __attribute__((always_inline))
+#else
+  #define INTERLEAVED_INLINE inline
+#endif
+
+/// What the lanes of row_interleaved() share.
+template <class T>
+struct Interleaving {
+  const View<T> * view;
+  T dx, ci, tolerance;
+  int warmup;
+  int x1, x2;
+  int next;               /// Next pixel to hand out
+  int saved;
+  int * counts;
+  float * norms;
+};
+
+/// One pixel in flight in row_interleaved().
+template <class T>
+struct Lane {
+  int p;                  /// Pixel, or -1 while empty
+  int i;
+  int live;               /// 1 until the pixel escapes or reaches the limit
+  int blocks;             /// Blocks stepped past the periodicity warmup
+  int i0;                 /// i at the start of the block
+  T cr, x, y, sx, sy;
+  T zx[INTERLEAVED_BLOCK + 1], zy[INTERLEAVED_BLOCK + 1];   /// Z after k steps of the block
+};
+
+/// Step k of the block for the lane, without a branch.  Z is stepped whether
+/// or not the lane is still live, and may run off to infinity once it is out;
+/// only the count stops, where row_scalar() would have.  Returns whether the
+/// lane is still live.
+template <class T>
+static inline int step(Lane<T> & lane, const T & ci, int limit, int k)
+{
+  T xx = lane.x * lane.x, yy = lane.y * lane.y;
+  lane.live &= (xx + yy < T(4)) & (lane.i < limit);
+  lane.y = T(2) * lane.x * lane.y + ci;
+  lane.x = xx - yy + lane.cr;
+  lane.i += lane.live;
+  lane.zx[k] = lane.x;
+  lane.zy[k] = lane.y;
+  return lane.live;
+}
+
+/// Marks where the lane's next block starts.  Returns true.
+template <class T>
+static inline bool begin_block(Lane<T> & lane)
+{
+  lane.i0 = lane.i;
+  lane.zx[0] = lane.x;
+  lane.zy[0] = lane.y;
+  return true;
+}
+
+/// Between blocks: writes out the lane's pixel if it has finished, or else
+/// checks it for periodicity, and hands a finished lane the next pixel that
+/// needs iterating.  Pixels in the main cardioid or period-2 bulb are filled
+/// in on the way.  Returns whether the lane has a pixel.
+template <class T>
+static INTERLEAVED_INLINE bool refill(Interleaving<T> & row, Lane<T> & lane)
+{
+  const View<T> & view = *row.view;
+  if (lane.p >= 0) {
+    int limit = view.limit;
+    /// Escaped within the block: Z from the step it escaped at.
+    if (!lane.live && lane.i < limit) {
+      lane.x = lane.zx[lane.i - lane.i0];
+      lane.y = lane.zy[lane.i - lane.i0];
+    }
+    bool escaped = !(lane.x*lane.x + lane.y*lane.y < T(4));
+    if (lane.i < limit && !escaped) {
+      if (lane.i < row.warmup)
+        return begin_block(lane);
+      /// Brent's method once a block: Z is compared against the point saved
+      /// at 0, 1, 2, 4, ... blocks past the warmup, which finds a cycle of any
+      /// period once the saves are that many blocks apart.
+      int b = lane.blocks++;
+      T ex = lane.x - lane.sx;
+      T ey = lane.y - lane.sy;
+      if (b == 0 || !(ex*ex + ey*ey < row.tolerance)) {
+        if (b == (b & -b)) {
+          lane.sx = lane.x;
+          lane.sy = lane.y;
+        }
+        return begin_block(lane);
+      }
+      row.saved += limit - lane.i;
+      lane.i = limit;
+    }
+    row.counts[lane.p - row.x1] = lane.i;
+    row.norms[lane.p - row.x1] = lane.i < limit ? norm_of(lane.x, lane.y) : 0;
+  }
+  while (row.next < row.x2) {
+    int q = row.next++;
+    T cr = view.cx + T(q - view.width / 2) * row.dx;
+    if (in_main_bulbs(cr, row.ci)) {
+      row.counts[q - row.x1] = view.limit;
+      row.norms[q - row.x1] = 0;
+      continue;
+    }
+    /// Z_1 is c itself, exactly, so the lane starts there.
+    lane.p = q;
+    lane.i = 1;
+    lane.live = 1;
+    lane.blocks = 0;
+    lane.cr = cr;
+    lane.x = cr;
+    lane.y = row.ci;
+    return begin_block(lane);
+  }
+  lane.p = -1;
+  lane.live = 0;
+  return false;
+}
+
+template <class T>
+int row_interleaved(const View<T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  if (view.formula != FORMULA_MULTIBROT || view.power != 2 || view.julia)
+    return row_scalar(view, j, x1, x2, counts, norms);
+  Interleaving<T> row;
+  row.view = &view;
+  row.dx = view.scale / T(view.width);
+  row.ci = view.cy + T(j - view.height / 2) * (view.scale / T(view.height));
+  row.tolerance = periodicity_tolerance(T());
+  row.warmup = periodicity_warmup(view.limit);
+  row.x1 = x1;
+  row.x2 = x2;
+  row.next = x1;
+  row.saved = 0;
+  row.counts = counts;
+  row.norms = norms;
+
+  /// Separate variables rather than an array, so that each lane stays in
+  /// registers as a dependency chain of its own.  An empty lane steps 0 + 0.
+  Lane<T> a, b, c, d;
+  a.p = b.p = c.p = d.p = -1;
+  a.i = b.i = c.i = d.i = 0;
+  a.live = b.live = c.live = d.live = a.blocks = b.blocks = c.blocks = d.blocks = 0;
+  a.cr = b.cr = c.cr = d.cr = T(0);
+  a.x = b.x = c.x = d.x = a.y = b.y = c.y = d.y = T(0);
+  T ci = row.ci;
+  int limit = view.limit;
+  while (refill(row, a) | refill(row, b) | refill(row, c) | refill(row, d)) {
+    for (int k = 1; k <= INTERLEAVED_BLOCK; ++k) {
+      if (!(step(a, ci, limit, k) | step(b, ci, limit, k) | step(c, ci, limit, k) | step(d, ci, limit, k)))
+        break;
+    }
+  }
+  return row.saved;
+}
+
+template int row_interleaved<float>(const View<float> &, int, int, int, int *, float *);
+template int row_interleaved<double>(const View<double> &, int, int, int, int *, float *);
+template int row_interleaved<DoubleDouble>(const View<DoubleDouble> &, int, int, int, int *, float *);
+
+void delta_scalar(const Orbit & orbit, int limit, int start,
+                  const double * dcr, const double * dci,
+                  const double * d0r, const double * d0i,
+                  int count, int * counts, float * norms)
+{
+  int steps = limit < orbit.length ? limit : orbit.length;
+  for (int p = 0; p < count; ++p) {
+    double dr = d0r ? d0r[p] : 0;
+    double di = d0i ? d0i[p] : 0;
+    int i = start;
+    bool glitched = false;
+    double r2 = 0;
+    for (; i < steps; ++i) {
+      double zr = orbit.zr[i] + dr;
+      double zi = orbit.zi[i] + di;
+      r2 = zr*zr + zi*zi;
+      if (r2 >= 4)
+        break;
+      if (r2 < GLITCH_TOLERANCE * (orbit.zr[i]*orbit.zr[i] + orbit.zi[i]*orbit.zi[i])) {
+        glitched = true;
+        break;
+      }
+      double tmp = 2 * (orbit.zr[i]*dr - orbit.zi[i]*di) + dr*dr - di*di + dcr[p];
+      di = 2 * (orbit.zr[i]*di + orbit.zi[i]*dr) + 2*dr*di + dci[p];
+      dr = tmp;
+    }
+    /// Still going when the reference escaped: nothing left to perturb from.
+    if (i == steps && steps < limit)
+      glitched = true;
+    counts[p] = glitched ? GLITCHED : i;
+    norms[p] = i < limit ? (float)r2 : 0;
+  }
+}
+
+/// newton_scalar() for one degree.
+template <class T, int Degree>
+static void newton_degree(const View<T> & view, const Polynomial<T> & poly, int j, int x1, int x2,
+                          int * counts, int * roots)
+{
+  T dx = view.scale / T(view.width);
+  T py = view.cy + T(j - view.height / 2) * (view.scale / T(view.height));
+  T tolerance = T(NEWTON_TOLERANCE);
+  for (int p = x1; p < x2; ++p) {
+    T x = view.cx + T(p - view.width / 2) * dx;
+    T y = py;
+    int i = 0;
+    bool converged = false;
+    while (!converged && i < view.limit) {
+      T sr, si;
+      NewtonStep<Scalar<T>, Degree>::apply(poly.ar, poly.ai, T(1), x, y, sr, si);
+      ++i;
+      converged = sr*sr + si*si < tolerance;
+    }
+    counts[p - x1] = converged ? i : view.limit;
+    roots[p - x1] = converged ? nearest_root(poly, x, y) : -1;
+  }
+}
+
+template <class T>
+void newton_scalar(const View<T> & view, const Polynomial<T> & poly, int j, int x1, int x2,
+                   int * counts, int * roots)
+{
+  switch (poly.degree) {
+  case 2:
+    return newton_degree<T, 2>(view, poly, j, x1, x2, counts, roots);
+  case 3:
+    return newton_degree<T, 3>(view, poly, j, x1, x2, counts, roots);
+  case 4:
+    return newton_degree<T, 4>(view, poly, j, x1, x2, counts, roots);
+  case 5:
+    return newton_degree<T, 5>(view, poly, j, x1, x2, counts, roots);
+  case 6:
+    return newton_degree<T, 6>(view, poly, j, x1, x2, counts, roots);
+  case 7:
+    return newton_degree<T, 7>(view, poly, j, x1, x2, counts, roots);
+  default:
+    return newton_degree<T, 8>(view, poly, j, x1, x2, counts, roots);
+  }
+}
+
+template void newton_scalar<float>(const View<float> &, const Polynomial<float> &, int, int, int,
+                                   int *, int *);
+template void newton_scalar<double>(const View<double> &, const Polynomial<double> &, int, int, int,
+                                    int *, int *);
+
+static const char * precision_names[PRECISION_COUNT] = {
+  "float", "double", "long double", "double-double",
+  "128-bit fixed", "256-bit fixed", "1024-bit fixed"
+};
+
+const char * precision_name(Precision precision)
+{
+  if (precision < 0 || precision >= PRECISION_COUNT)
+    return "unknown";
+  return precision_names[precision];
+}
+
+static const char * formula_names[FORMULA_COUNT] = {
+  "multibrot", "multicorn", "burning ship"
+};
+
+const char * formula_name(Formula formula)
+{
+  if (formula < 0 || formula >= FORMULA_COUNT)
+    return "unknown";
+  return formula_names[formula];
+}
+
+Precision precision_for(const View<double> & view)
+{
+  /// Relative size of one pixel against the largest coordinate in the frame.
+  /// A type resolves the view if its epsilon is at least 16 times smaller,
+  /// which leaves headroom for the rounding errors the iteration piles up.
+  double size = std::fabs(view.scale);
+  double cx = std::fabs(view.cx);
+  double cy = std::fabs(view.cy);
+  double extent = (cx > cy ? cx : cy) + size;
+  if (extent < 1)
+    extent = 1;
+  int pixels = view.width > view.height ? view.width : view.height;
+  double step = size / pixels;
+  double spacing = step / extent;
+
+  if (spacing > 16 * FLT_EPSILON)
+    return PRECISION_FLOAT;
+  if (spacing > 16 * DBL_EPSILON)
+    return PRECISION_DOUBLE;
+  /// Where long double is no wider than double (e.g. MSVC), go straight on.
+  if (LDBL_MANT_DIG > DBL_MANT_DIG && spacing > 16 * LDBL_EPSILON)
+    return PRECISION_LONG_DOUBLE;
+  if (spacing > 16 * std::ldexp(1.0, -104))
+    return PRECISION_DOUBLE_DOUBLE;
+  /// Fixed point is as precise everywhere, so it goes by the pixel size alone.
+  if (step > 16 * std::ldexp(1.0, -Fixed128::fraction_bits))
+    return PRECISION_FIXED_128;
+  if (step > 16 * std::ldexp(1.0, -Fixed256::fraction_bits))
+    return PRECISION_FIXED_256;
+  return PRECISION_FIXED_1024;
+}
+
+const KernelSet kernels_scalar = {
+  ISA_SCALAR,
+  row_interleaved<float>,
+  row_interleaved<double>,
+  row_scalar<long double>,
+  row_interleaved<DoubleDouble>,
+  delta_scalar,
+  row_distance_scalar<float>,
+  row_distance_scalar<double>,
+  row_distance_scalar<long double>,
+  row_distance_scalar<DoubleDouble>,
+  newton_scalar<float>,
+  newton_scalar<double>
+};
+
+const KernelSet & kernels_for(Isa isa)
+{
+  switch (isa) {
+  case ISA_SSE2:
+    return kernels_sse2;
+  case ISA_AVX2:
+    return kernels_avx2;
+  case ISA_AVX512:
+    return kernels_avx512;
+  default:
+    return kernels_scalar;
+  }
+}
@@ -0,0 +1,449 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Row kernels for the Mandelbrot renderer.  These do not depend on OpenGL, so
+/// they can be compiled with different instruction sets in their own
+/// translation units.
+#pragma once
+#include <cfloat>
+#include <cmath>
+#include "Cpu.h"
+#include "DoubleDouble.h"
+#include "Formulas.h"
+
+/// Everything a kernel needs to know to map a pixel onto the complex plane,
+/// in the number type T the kernel iterates with.  A pixel (i, j) maps to
+///
+///   cr = cx + (i - width / 2) * (scale / width)
+///   ci = cy + (j - height / 2) * (scale / height)
+///
+/// Keeping the centre rather than an offset in pixels means the coordinates
+/// stay as precise as T allows, however far in we zoom.
+template <class T>
+struct View {
+  int limit;              /// Upper bound number of computing interations per pixel
+  T scale;                /// Size of the frame on the complex plane
+  T cx;                   /// Centre of the frame on the real axis
+  T cy;                   /// Centre of the frame on the imaginary axis
+  int width;              /// Resolution of the frame
+  int height;
+  int formula;            /// Formula of the orbit, see Formula
+  int power;              /// Power of z in it; 2 is the Mandelbrot set, 3 to 8 Multibrots
+  bool julia;             /// Julia set of c = (jr, ji) instead: Z starts at the pixel, c is fixed
+  T jr;
+  T ji;
+};
+
+/// Whether two views are the same frame.  Field by field, as the bytes of the
+/// padding after julia need not match.
+template <class T>
+static inline bool same_view(const View<T> & a, const View<T> & b)
+{
+  return a.limit == b.limit && a.scale == b.scale && a.cx == b.cx && a.cy == b.cy
+         && a.width == b.width && a.height == b.height && a.formula == b.formula
+         && a.power == b.power && a.julia == b.julia && a.jr == b.jr && a.ji == b.ji;
+}
+
+/// Name of the formula, e.g. "burning ship".
+const char * formula_name(Formula formula);
+
+/// Rounds a view to another number type, with the convert() overloads that
+/// come with each type (DoubleDouble.h, BigFixed.h).
+template <class T, class M>
+static inline View<T> view_as(const View<M> & view)
+{
+  View<T> v;
+  v.limit = view.limit;
+  convert(view.scale, v.scale);
+  convert(view.cx, v.cx);
+  convert(view.cy, v.cy);
+  v.width = view.width;
+  v.height = view.height;
+  v.formula = view.formula;
+  v.power = view.power;
+  v.julia = view.julia;
+  convert(view.jr, v.jr);
+  convert(view.ji, v.ji);
+  return v;
+}
+
+/// Number types the kernels come in, cheapest first.
+enum Precision {
+  PRECISION_FLOAT,
+  PRECISION_DOUBLE,
+  PRECISION_LONG_DOUBLE,  /// 80-bit x87 where available; skipped where it is just double
+  PRECISION_DOUBLE_DOUBLE,
+  PRECISION_FIXED_128,    /// BigFixed.h; reference orbits only, there are no row kernels
+  PRECISION_FIXED_256,
+  PRECISION_FIXED_1024,
+  PRECISION_COUNT
+};
+
+/// Name of the precision, e.g. "double".
+const char * precision_name(Precision precision);
+
+/// Cheapest precision that still resolves the pixel spacing of the view, i.e.
+/// leaves several representable numbers between neighbouring pixels.  The
+/// view only needs to be in double for this.
+Precision precision_for(const View<double> & view);
+
+/// Whether c lies inside the main cardioid or the period-2 bulb.  Every such
+/// point is interior, so iterating it would only run to the limit:
+///
+///   q = (cr - 1/4)^2 + ci^2,  q (q + cr - 1/4) < ci^2 / 4
+///   (cr + 1)^2 + ci^2 < 1/16
+template <class T>
+static inline bool in_main_bulbs(const T & cr, const T & ci)
+{
+  T yy = ci * ci;
+  T a = cr - T(0.25);
+  T q = a * a + yy;
+  if (q * (q + a) < yy * T(0.25))
+    return true;
+  T b = cr + T(1);
+  return b * b + yy < T(0.0625);
+}
+
+/// Squared distance within which an orbit counts as having come back to an
+/// earlier point, i.e. as having converged to a cycle: 16 epsilon of the
+/// number type, squared, which is close to the rounding noise of |Z| < 2.
+static inline float periodicity_tolerance(float)
+{
+  return (16 * FLT_EPSILON) * (16 * FLT_EPSILON);
+}
+
+static inline double periodicity_tolerance(double)
+{
+  return (16 * DBL_EPSILON) * (16 * DBL_EPSILON);
+}
+
+static inline long double periodicity_tolerance(long double)
+{
+  return (16 * LDBL_EPSILON) * (16 * LDBL_EPSILON);
+}
+
+static inline DoubleDouble periodicity_tolerance(const DoubleDouble &)
+{
+  return DoubleDouble(std::ldexp(1.0, -200));   /// (16 * 2^-104)^2
+}
+
+/// |Z|^2 rounded to float, for the norms the kernels write.
+template <class T>
+static inline float norm_of(const T & x, const T & y)
+{
+  return (float)(x*x + y*y);
+}
+
+static inline float norm_of(const DoubleDouble & x, const DoubleDouble & y)
+{
+  return (float)to_double(x*x + y*y);
+}
+
+/// Iterations before the periodicity check starts.  Orbits take a while to
+/// settle into their cycle, and most exterior points escape early, so the
+/// check would only slow them down before this.
+static inline int periodicity_warmup(int limit)
+{
+  return limit / 4;
+}
+
+/// Computes the escape counts of pixels [x1, x2) on row j, writing them to
+/// counts[0 .. x2-x1).  A count is the number of iterations taken before |Z|
+/// reached 2, and equals view.limit for points that never escaped.  Points in
+/// the main cardioid and period-2 bulb get view.limit without iterating.
+///
+/// norms[0 .. x2-x1) receives |Z|^2 at the escape, the first value of at least
+/// 4, or 0 for points at view.limit.  Nothing is scaled or coloured here, so
+/// smooth colouring and the like can work from counts and norms alone.
+///
+/// Kernels iterate the formula of the view in its power, and pick a loop
+/// compiled for that formula (Multibrot and the like) once per row, and for
+/// the Julia set if view.julia is set.  The cardioid and bulb test only
+/// applies to the Mandelbrot set proper.
+///
+/// Interior orbits that settle into a cycle are caught by Brent's method: past
+/// periodicity_warmup(), Z is compared against a point saved at every power of
+/// two iterations, and once it comes back within periodicity_tolerance() the
+/// pixel gets view.limit.  Returns the number of iterations that saved.
+template <class T>
+struct RowKernel {
+  typedef int (*type)(const View<T> & view, int j, int x1, int x2, int * counts, float * norms);
+};
+
+/// Reference implementation, one pixel at a time.  Instantiated in Kernels.cpp
+/// for float, double, long double and DoubleDouble, in every formula and power.
+template <class T>
+int row_scalar(const View<T> & view, int j, int x1, int x2, int * counts, float * norms);
+
+/// Iterations row_deferred() runs between escape checks.
+enum { BAILOUT_DEFERRAL = 8 };
+
+/// row_scalar() with fewer branches.  Past the first BAILOUT_DEFERRAL
+/// iterations, which most escaping pixels never get beyond, orbits are stepped
+/// BAILOUT_DEFERRAL iterations at a time and only checked for escape after each
+/// block.  Once |Z| passes 2 (and |c| <= 2, or it would have escaped at Z_1)
+/// it only grows, and infinity or NaN from overflowing on the way fail the
+/// check just the same, so a block escaped iff the orbit is out at its end;
+/// Z is kept after every step of the block, to find where.  The periodicity
+/// check runs once a block too.  The counts equal row_scalar()'s.  It is no
+/// faster than row_interleaved(), so no KernelSet uses it, and Benchmark times
+/// it against row_scalar().  Anything but the Mandelbrot set itself goes to
+/// row_scalar().
+template <class T>
+int row_deferred(const View<T> & view, int j, int x1, int x2, int * counts, float * norms);
+
+/// Iterations row_interleaved() steps its pixels between looking at which have
+/// finished.
+enum { INTERLEAVED_BLOCK = 8 };
+
+/// row_scalar() with 4 pixels in flight at once, so that their chains of
+/// dependent multiplies overlap.  All 4 are stepped together for up to
+/// INTERLEAVED_BLOCK iterations, without a branch on any one of them, and
+/// only between blocks are finished pixels written out and their lanes refilled,
+/// and the rest checked for periodicity.  Gives the same counts and norms as
+/// row_scalar(), bit for bit, and is the row kernel of kernels_scalar in
+/// float, double and DoubleDouble; long double stays on row_scalar(), as the
+/// x87 stack holds too few registers for the lanes.  Anything but the
+/// Mandelbrot set itself goes to row_scalar().
+template <class T>
+int row_interleaved(const View<T> & view, int j, int x1, int x2, int * counts, float * norms);
+
+/// RowKernel that also steps the derivative dZ alongside the orbit, by c for
+/// the Mandelbrot set and by Z_0 for Julia sets, with the pixel as the unit of
+/// both, and writes distances[0 .. x2-x1): an estimate of how far each escaped
+/// point lies from the set, in pixels,
+///
+///   |Z| log |Z| / (2 |dZ|)
+///
+/// at the escape (Hubbard and Douady), or 0 for points at view.limit.  Counts
+/// and norms are the same as from the row kernel.  The estimate needs a
+/// complex derivative, which only the Multibrot formula has; with the others
+/// every distance is 0.
+template <class T>
+struct DistanceKernel {
+  typedef int (*type)(const View<T> & view, int j, int x1, int x2, int * counts, float * norms,
+                      float * distances);
+};
+
+/// Distance in pixels from |Z|^2 and |dZ|^2 at the escape; see DistanceKernel.
+/// A derivative that overflowed gives 0, as such a point is right on the set,
+/// and so does one that vanished, on an orbit through the critical point 0,
+/// where the estimate breaks down.
+static inline float distance_estimate(float norm, float dnorm)
+{
+  float d = 0.25f * std::sqrt(norm / dnorm) * std::log(norm);
+  return d > 0 && d <= FLT_MAX ? d : 0;
+}
+
+/// Reference distance kernel, one pixel at a time.
+template <class T>
+int row_distance_scalar(const View<T> & view, int j, int x1, int x2, int * counts, float * norms,
+                        float * distances);
+
+/// Orbit of the reference point of a perturbation render, Z_0 .. Z_{length-1},
+/// computed in high precision and rounded to double.  The last point may be
+/// the one where the reference escaped.
+struct Orbit {
+  const double * zr;
+  const double * zi;
+  int length;
+};
+
+/// Marks a pixel whose perturbation went wrong and needs another reference.
+enum { GLITCHED = -1 };
+
+/// A perturbation is flagged as a glitch once |Z_n + d_n|^2 falls below this
+/// fraction of |Z_n|^2, i.e. the pixel's orbit has lost most of the bits it
+/// shared with the reference (Pauldelbrot's criterion).
+static const double GLITCH_TOLERANCE = 1e-6;
+
+/// Perturbation kernel.  Pixel k lies at (dcr[k], dci[k]) from the reference,
+/// and only the difference d_n between its orbit and the reference orbit is
+/// iterated, in double:
+///
+///   d_{n+1} = 2 Z_n d_n + d_n^2 + dc
+///
+/// Iteration starts at n = start, from d_start = (d0r[k], d0i[k]); pass
+/// start = 0 and NULL for both to start from d_0 = 0.
+///
+/// counts[k] and norms[k] receive the escape count and |Z|^2 as for
+/// RowKernel, or counts[k] GLITCHED if the pixel glitched or outlived the
+/// reference orbit.
+typedef void (*DeltaKernel)(const Orbit & orbit, int limit, int start,
+                            const double * dcr, const double * dci,
+                            const double * d0r, const double * d0i,
+                            int count, int * counts, float * norms);
+
+/// Reference perturbation kernel, one pixel at a time.
+void delta_scalar(const Orbit & orbit, int limit, int start,
+                  const double * dcr, const double * dci,
+                  const double * d0r, const double * d0i,
+                  int count, int * counts, float * norms);
+
+/// Degrees of the polynomials the Newton kernels come in.
+enum { MIN_DEGREE = 2, MAX_DEGREE = 8 };
+
+/// Polynomial for Newton's method, monic and given by its roots:
+///
+///   p(z) = (z - r_0) (z - r_1) ... (z - r_{degree-1})
+///        = a_0 + a_1 z + ... + z^degree
+///
+/// The coefficients are multiplied out once per frame by expand_roots(), so
+/// the kernels only ever evaluate p.
+template <class T>
+struct Polynomial {
+  int degree;
+  T rr[MAX_DEGREE];       /// Roots
+  T ri[MAX_DEGREE];
+  T ar[MAX_DEGREE + 1];   /// Coefficients of z^0 .. z^degree
+  T ai[MAX_DEGREE + 1];
+};
+
+/// Whether two polynomials have the same degree and roots.  Entries past the
+/// degree are left over from earlier ones, and the coefficients follow from
+/// the roots (see expand_roots()), so neither is compared.
+template <class T>
+static inline bool same_polynomial(const Polynomial<T> & a, const Polynomial<T> & b)
+{
+  if (a.degree != b.degree)
+    return false;
+  for (int k = 0; k < a.degree; ++k)
+    if (a.rr[k] != b.rr[k] || a.ri[k] != b.ri[k])
+      return false;
+  return true;
+}
+
+/// Sets the coefficients of p from its roots, multiplying in (z - r_k) one
+/// root at a time.
+static inline void expand_roots(Polynomial<double> & p)
+{
+  for (int k = 0; k <= p.degree; ++k) {
+    p.ar[k] = k == 0 ? 1 : 0;
+    p.ai[k] = 0;
+  }
+  for (int n = 0; n < p.degree; ++n) {
+    /// a <- a (z - r_n), from the top coefficient down.
+    for (int k = n + 1; k >= 0; --k) {
+      double lr = k > 0 ? p.ar[k - 1] : 0;
+      double li = k > 0 ? p.ai[k - 1] : 0;
+      double r = lr - (p.ar[k] * p.rr[n] - p.ai[k] * p.ri[n]);
+      double i = li - (p.ar[k] * p.ri[n] + p.ai[k] * p.rr[n]);
+      p.ar[k] = r;
+      p.ai[k] = i;
+    }
+  }
+}
+
+/// Rounds a polynomial to the number type of a kernel.
+template <class T>
+static inline Polynomial<T> polynomial_as(const Polynomial<double> & p)
+{
+  Polynomial<T> q;
+  q.degree = p.degree;
+  for (int k = 0; k < p.degree; ++k) {
+    q.rr[k] = (T)p.rr[k];
+    q.ri[k] = (T)p.ri[k];
+  }
+  for (int k = 0; k <= p.degree; ++k) {
+    q.ar[k] = (T)p.ar[k];
+    q.ai[k] = (T)p.ai[k];
+  }
+  return q;
+}
+
+/// Newton's method stops once a step moves Z by less than this, squared.
+/// Convergence is quadratic by then, so Z is as good as on the root.
+static const double NEWTON_TOLERANCE = 1e-8;
+
+/// Runs Newton's method on poly from each of pixels [x1, x2) on row j,
+///
+///   Z' = Z - p(Z) / p'(Z)
+///
+/// with p and p' evaluated together by Horner's rule.  counts[0 .. x2-x1)
+/// receives the number of steps taken, and roots[0 .. x2-x1) the index of the
+/// root Z converged to, or view.limit and -1 for pixels that did not.  Only
+/// limit and the mapping of pixels in view are used.
+template <class T>
+struct NewtonKernel {
+  typedef void (*type)(const View<T> & view, const Polynomial<T> & poly, int j, int x1, int x2,
+                       int * counts, int * roots);
+};
+
+/// One step of Newton's method on a monic polynomial of the given degree with
+/// coefficients (ar, ai), written against the wrappers in Simd.h or Scalar.
+/// Moves (x, y) and leaves the step it took in (sr, si).  one is 1 in S.
+/// The quotient p / p' takes a single division, for 1 / |p'|^2.
+template <class S, int Degree>
+struct NewtonStep {
+  typedef typename S::V V;
+  static void apply(const V * ar, const V * ai, const V & one, V & x, V & y, V & sr, V & si) {
+    /// Horner's rule for p and p' at once, starting from the top two terms:
+    /// p = z + a_{n-1} and p' = 1.
+    V pr = S::add(x, ar[Degree - 1]);
+    V pi = S::add(y, ai[Degree - 1]);
+    V dr = one;
+    V di = S::sub(one, one);
+    for (int k = Degree - 2; k >= 0; --k) {
+      V t = S::fmsub(dr, x, S::fmsub(di, y, pr));
+      di = S::fmadd(dr, y, S::fmadd(di, x, pi));
+      dr = t;
+      t = S::fmsub(pr, x, S::fmsub(pi, y, ar[k]));
+      pi = S::fmadd(pr, y, S::fmadd(pi, x, ai[k]));
+      pr = t;
+    }
+    V inv = S::div(one, S::fmadd(dr, dr, S::mul(di, di)));
+    sr = S::mul(S::fmadd(pr, dr, S::mul(pi, di)), inv);
+    si = S::mul(S::fmsub(pi, dr, S::mul(pr, di)), inv);
+    x = S::sub(x, sr);
+    y = S::sub(y, si);
+  }
+};
+
+/// Reference Newton kernel, one pixel at a time.
+template <class T>
+void newton_scalar(const View<T> & view, const Polynomial<T> & poly, int j, int x1, int x2,
+                   int * counts, int * roots);
+
+/// Index of the root of poly nearest to (x, y).
+template <class T>
+static inline int nearest_root(const Polynomial<T> & poly, T x, T y)
+{
+  int best = 0;
+  T best_d = 0;
+  for (int k = 0; k < poly.degree; ++k) {
+    T ex = x - poly.rr[k];
+    T ey = y - poly.ri[k];
+    T d = ex*ex + ey*ey;
+    if (k == 0 || d < best_d) {
+      best = k;
+      best_d = d;
+    }
+  }
+  return best;
+}
+
+/// The kernels compiled for one instruction set.  Each Kernels*.cpp file
+/// defines one of these; pick one with kernels_for() once at startup so the
+/// inner loops never have to branch on the instruction set.
+struct KernelSet {
+  Isa isa;
+  RowKernel<float>::type row_float;               /// Escape counts for a row of pixels
+  RowKernel<double>::type row_double;
+  RowKernel<long double>::type row_long_double;   /// Always scalar, x87 has no SIMD
+  RowKernel<DoubleDouble>::type row_double_double;
+  DeltaKernel delta;                              /// Perturbation against a reference orbit
+  DistanceKernel<float>::type distance_float;     /// Row kernels with distance estimates
+  DistanceKernel<double>::type distance_double;
+  DistanceKernel<long double>::type distance_long_double;
+  DistanceKernel<DoubleDouble>::type distance_double_double;
+  NewtonKernel<float>::type newton_float;        /// Newton's method for the Newton renderer
+  NewtonKernel<double>::type newton_double;
+};
+
+extern const KernelSet kernels_scalar;    /// Kernels.cpp
+extern const KernelSet kernels_sse2;      /// KernelsSSE2.cpp, 4 floats or 2 doubles at a time
+extern const KernelSet kernels_avx2;      /// KernelsAVX2.cpp, 8 floats or 4 doubles at a time
+extern const KernelSet kernels_avx512;    /// KernelsAVX512.cpp, 16 floats or 8 doubles at a time
+
+/// Kernels for the given instruction set.  Check it with cpu_detect() first.
+const KernelSet & kernels_for(Isa isa);
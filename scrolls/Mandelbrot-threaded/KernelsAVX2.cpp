@@ -0,0 +1,19 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// This file must be compiled with AVX2 enabled (-mavx2 -mfma, or /arch:AVX2).
+#include "KernelsSimd.h"
+
+const KernelSet kernels_avx2 = {
+  ISA_AVX2,
+  row_simd<FloatAVX2>,
+  row_simd<DoubleAVX2>,
+  row_scalar<long double>,
+  row_simd<DoubleDoubleSimd<DoubleAVX2> >,
+  delta_simd<DoubleAVX2>,
+  row_distance<FloatAVX2>,
+  row_distance<DoubleAVX2>,
+  row_distance_scalar<long double>,
+  row_distance<DoubleDoubleSimd<DoubleAVX2> >,
+  newton_simd<FloatAVX2>,
+  newton_simd<DoubleAVX2>
+};
@@ -0,0 +1,19 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// This file must be compiled with AVX-512 enabled (-mavx512f, or /arch:AVX512).
+#include "KernelsSimd.h"
+
+const KernelSet kernels_avx512 = {
+  ISA_AVX512,
+  row_simd<FloatAVX512>,
+  row_simd<DoubleAVX512>,
+  row_scalar<long double>,
+  row_simd<DoubleDoubleSimd<DoubleAVX512> >,
+  delta_simd<DoubleAVX512>,
+  row_distance<FloatAVX512>,
+  row_distance<DoubleAVX512>,
+  row_distance_scalar<long double>,
+  row_distance<DoubleDoubleSimd<DoubleAVX512> >,
+  newton_simd<FloatAVX512>,
+  newton_simd<DoubleAVX512>
+};
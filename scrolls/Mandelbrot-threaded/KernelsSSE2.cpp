@@ -0,0 +1,19 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// This file must be compiled with SSE2 enabled (-msse2, the default on x86-64).
+#include "KernelsSimd.h"
+
+const KernelSet kernels_sse2 = {
+  ISA_SSE2,
+  row_simd<FloatSSE2>,
+  row_simd<DoubleSSE2>,
+  row_scalar<long double>,
+  row_simd<DoubleDoubleSimd<DoubleSSE2> >,
+  delta_simd<DoubleSSE2>,
+  row_distance<FloatSSE2>,
+  row_distance<DoubleSSE2>,
+  row_distance_scalar<long double>,
+  row_distance<DoubleDoubleSimd<DoubleSSE2> >,
+  newton_simd<FloatSSE2>,
+  newton_simd<DoubleSSE2>
+};
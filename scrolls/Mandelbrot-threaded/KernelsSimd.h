@@ -0,0 +1,486 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Kernel templates over the wrappers in Simd.h.  Each Kernels*.cpp file
+/// instantiates these for the instruction set it is compiled with.
+#pragma once
+#include "Kernels.h"
+#include "Simd.h"
+
+/// Lanes of c inside the main cardioid or the period-2 bulb; the same test as
+/// in_main_bulbs() in Kernels.h.
+template <class S>
+typename S::Mask main_bulbs_mask(typename S::V cr, typename S::V ci)
+{
+  typedef typename S::T T;
+  typedef typename S::V V;
+  V yy = S::mul(ci, ci);
+  V a = S::sub(cr, S::set1(T(0.25)));
+  V q = S::fmadd(a, a, yy);
+  typename S::Mask cardioid = S::lt(S::mul(q, S::add(q, a)), S::mul(yy, S::set1(T(0.25))));
+  V b = S::add(cr, S::set1(T(1)));
+  typename S::Mask bulb = S::lt(S::fmadd(b, b, yy), S::set1(T(0.0625)));
+  return S::mask_or(cardioid, bulb);
+}
+
+/// Iterates the lanes of c in alive from iteration k1 up to k2, or until none
+/// is left, updating the orbits (x, y) and counts n.  Lanes leave alive as they
+/// escape, with |Z|^2 at that point left in norm.  Returns whether any lane is
+/// still going.  With Periodicity set, lanes whose orbit comes back to a saved
+/// point (Brent's method; see row_scalar()) move from alive to done; without
+/// it, the loop carries no trace of the check.  Formula steps the orbits
+/// (see Multibrot in Formulas.h).
+template <class S, class Formula, bool Periodicity>
+bool iterate_simd(typename S::V cr, typename S::V ci, int k1, int k2,
+                  typename S::V & x, typename S::V & y, typename S::Count & n,
+                  typename S::Mask & alive, typename S::Mask & done, typename S::V & norm)
+{
+  typedef typename S::T T;
+  typedef typename S::V V;
+  typedef typename S::Mask Mask;
+  const V four = S::set1(T(4));
+  const V tolerance = S::set1(periodicity_tolerance(T()));
+  V sx = x;
+  V sy = y;
+  for (int k = k1; k < k2; ++k) {
+    V yy = S::mul(y, y);
+    V r2 = S::fmadd(x, x, yy);
+    norm = S::select(alive, r2, norm);
+    alive = S::mask_and(alive, S::lt(r2, four));
+    if (!S::any(alive))
+      return false;
+    n = S::count_inc(n, alive);
+    Formula::template step<S>(x, y, cr, ci);
+
+    if (Periodicity) {
+      V ex = S::sub(x, sx);
+      V ey = S::sub(y, sy);
+      Mask back = S::mask_and(alive, S::lt(S::fmadd(ex, ex, S::mul(ey, ey)), tolerance));
+      done = S::mask_or(done, back);
+      alive = S::mask_andnot(alive, back);
+      int steps = k + 1 - k1;
+      if (steps == (steps & -steps)) {
+        sx = x;
+        sy = y;
+      }
+    }
+  }
+  return true;
+}
+
+/// Iterates S::width pixels of Formula at once, in whatever number type S
+/// works in: its Mandelbrot-style set, or with Julia set, the Julia set of
+/// c = (view.jr, view.ji).  Lanes drop out of the mask as they escape, and
+/// the row only moves on when every lane has escaped or hit the limit.  For
+/// the Mandelbrot set, lanes in the main cardioid or period-2 bulb start out
+/// of the mask, so a vector of them costs one test.  Lanes the periodicity
+/// check catches drop out like escaped ones.
+template <class S, class Formula, bool Julia>
+int row_formula(const View<typename S::T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  typedef typename S::T T;
+  typedef typename S::V V;
+  typedef typename S::Mask Mask;
+  const V lanes = S::index();
+  const V cx = S::set1(view.cx);
+  const V dx = S::set1(view.scale / T(view.width));
+  const V py = S::set1(view.cy + T(j - view.height / 2) * (view.scale / T(view.height)));
+  const V ci = Julia ? S::set1(view.ji) : py;
+  const int warmup = periodicity_warmup(view.limit);
+  int saved = 0;
+  bool check = true;      /// Whether to check for periodicity; see row_scalar()
+
+  for (int p = x1; p < x2; p += S::width) {
+    /// Same mapping as the scalar kernel, so both agree on every coordinate.
+    V px = S::add(S::set1(T(p - view.width / 2)), lanes);
+    V pr = S::add(cx, S::mul(px, dx));
+    V cr = Julia ? S::set1(view.jr) : pr;
+    Mask interior = Formula::main_bulbs && !Julia ? main_bulbs_mask<S>(cr, ci) : S::mask_none();
+    Mask alive = S::mask_andnot(S::mask_all(), interior);
+    Mask done = interior;
+    V x = Julia ? pr : S::set1(T(0));
+    V y = Julia ? py : S::set1(T(0));
+    V norm = S::set1(T(0));
+    typename S::Count n = S::count_zero();
+    if (!check) {
+      iterate_simd<S, Formula, false>(cr, ci, 0, view.limit, x, y, n, alive, done, norm);
+    } else if (iterate_simd<S, Formula, false>(cr, ci, 0, warmup, x, y, n, alive, done, norm)) {
+      iterate_simd<S, Formula, true>(cr, ci, warmup, view.limit, x, y, n, alive, done, norm);
+    }
+
+    int tail[S::width];
+    float tail_norms[S::width];
+    S::store(n, tail);
+    S::store_float(norm, tail_norms);
+    int inside = S::bits(interior);
+    int stopped = S::bits(done);
+    check = false;
+    for (int k = 0; k < S::width && p + k < x2; ++k) {
+      if ((stopped & ~inside) >> k & 1)
+        saved += view.limit - tail[k];
+      counts[p - x1 + k] = (stopped >> k) & 1 ? view.limit : tail[k];
+      norms[p - x1 + k] = counts[p - x1 + k] < view.limit ? tail_norms[k] : 0;
+      check = check || counts[p - x1 + k] == view.limit;
+    }
+  }
+  return saved;
+}
+
+template <class S, class Formula>
+int row_simd_formula(const View<typename S::T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  if (view.julia)
+    return row_formula<S, Formula, true>(view, j, x1, x2, counts, norms);
+  return row_formula<S, Formula, false>(view, j, x1, x2, counts, norms);
+}
+
+template <class S, template <int> class Formula>
+int row_simd_power(const View<typename S::T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  switch (view.power) {
+  case 3:
+    return row_simd_formula<S, Formula<3> >(view, j, x1, x2, counts, norms);
+  case 4:
+    return row_simd_formula<S, Formula<4> >(view, j, x1, x2, counts, norms);
+  case 5:
+    return row_simd_formula<S, Formula<5> >(view, j, x1, x2, counts, norms);
+  case 6:
+    return row_simd_formula<S, Formula<6> >(view, j, x1, x2, counts, norms);
+  case 7:
+    return row_simd_formula<S, Formula<7> >(view, j, x1, x2, counts, norms);
+  case 8:
+    return row_simd_formula<S, Formula<8> >(view, j, x1, x2, counts, norms);
+  default:
+    return row_simd_formula<S, Formula<2> >(view, j, x1, x2, counts, norms);
+  }
+}
+
+/// row_formula() for the formula and power of the view, picked once per row.
+template <class S>
+int row_simd(const View<typename S::T> & view, int j, int x1, int x2, int * counts, float * norms)
+{
+  switch (view.formula) {
+  case FORMULA_MULTICORN:
+    return row_simd_power<S, Multicorn>(view, j, x1, x2, counts, norms);
+  case FORMULA_BURNING_SHIP:
+    return row_simd_power<S, BurningShip>(view, j, x1, x2, counts, norms);
+  default:
+    return row_simd_power<S, Multibrot>(view, j, x1, x2, counts, norms);
+  }
+}
+
+/// iterate_simd() for Multibrot<Power>, also stepping the derivative
+/// (dr, di) of every orbit; see DistanceKernel.  step is one pixel, added to
+/// the derivative each iteration for the Mandelbrot set.  norm and dnorm, the
+/// |Z|^2 and |dZ|^2 the estimate needs, are only written on the iteration a
+/// lane escapes, so tracking them costs a branch that is rarely taken rather
+/// than a select every iteration.  The derivative never feeds back into the
+/// orbit, so its chain of multiplies overlaps with the orbit's.
+template <class S, int Power, bool Julia, bool Periodicity>
+bool iterate_distance(typename S::V cr, typename S::V ci, typename S::V step, int k1, int k2,
+                      typename S::V & x, typename S::V & y, typename S::V & dr, typename S::V & di,
+                      typename S::Count & n, typename S::Mask & alive, typename S::Mask & done,
+                      typename S::V & norm, typename S::V & dnorm)
+{
+  typedef typename S::T T;
+  typedef typename S::V V;
+  typedef typename S::Mask Mask;
+  const V four = S::set1(T(4));
+  const V power = S::set1(T(Power));
+  const V tolerance = S::set1(periodicity_tolerance(T()));
+  V sx = x;
+  V sy = y;
+  for (int k = k1; k < k2; ++k) {
+    V yy = S::mul(y, y);
+    V r2 = S::fmadd(x, x, yy);
+    Mask escaped = S::mask_andnot(alive, S::lt(r2, four));
+    if (S::any(escaped)) {
+      norm = S::select(escaped, r2, norm);
+      dnorm = S::select(escaped, S::fmadd(dr, dr, S::mul(di, di)), dnorm);
+      alive = S::mask_andnot(alive, escaped);
+    }
+    if (!S::any(alive))
+      return false;
+    n = S::count_inc(n, alive);
+    if (Power == 2) {
+      /// dZ' = 2 Z dZ (+ step), with the doubling folded into Z.
+      V x2 = S::add(x, x);
+      V y2 = S::add(y, y);
+      V t = S::fmsub(x2, dr, Julia ? S::mul(y2, di) : S::fmsub(y2, di, step));
+      di = S::fmadd(x2, di, S::mul(y2, dr));
+      dr = t;
+    } else {
+      V zx, zy;
+      ComplexPower<S, Power - 1>::apply(x, y, zx, zy);
+      V t = S::fmsub(zx, dr, S::mul(zy, di));
+      di = S::mul(power, S::fmadd(zx, di, S::mul(zy, dr)));
+      dr = Julia ? S::mul(power, t) : S::fmadd(power, t, step);
+    }
+    Multibrot<Power>::template step<S>(x, y, cr, ci);
+
+    if (Periodicity) {
+      V ex = S::sub(x, sx);
+      V ey = S::sub(y, sy);
+      Mask back = S::mask_and(alive, S::lt(S::fmadd(ex, ex, S::mul(ey, ey)), tolerance));
+      done = S::mask_or(done, back);
+      alive = S::mask_andnot(alive, back);
+      int steps = k + 1 - k1;
+      if (steps == (steps & -steps)) {
+        sx = x;
+        sy = y;
+      }
+    }
+  }
+  return true;
+}
+
+/// row_formula() for Multibrot<Power> with distance estimates; see
+/// DistanceKernel.  The orbits, counts and norms are row_formula()'s.
+template <class S, int Power, bool Julia>
+int row_distance_multibrot(const View<typename S::T> & view, int j, int x1, int x2, int * counts,
+                           float * norms, float * distances)
+{
+  typedef typename S::T T;
+  typedef typename S::V V;
+  typedef typename S::Mask Mask;
+  const V lanes = S::index();
+  const V cx = S::set1(view.cx);
+  const V dx = S::set1(view.scale / T(view.width));
+  const V py = S::set1(view.cy + T(j - view.height / 2) * (view.scale / T(view.height)));
+  const V ci = Julia ? S::set1(view.ji) : py;
+  const int warmup = periodicity_warmup(view.limit);
+  int saved = 0;
+  bool check = true;
+
+  for (int p = x1; p < x2; p += S::width) {
+    V px = S::add(S::set1(T(p - view.width / 2)), lanes);
+    V pr = S::add(cx, S::mul(px, dx));
+    V cr = Julia ? S::set1(view.jr) : pr;
+    Mask interior = Power == 2 && !Julia ? main_bulbs_mask<S>(cr, ci) : S::mask_none();
+    Mask alive = S::mask_andnot(S::mask_all(), interior);
+    Mask done = interior;
+    V x = Julia ? pr : S::set1(T(0));
+    V y = Julia ? py : S::set1(T(0));
+    V dr = Julia ? dx : S::set1(T(0));
+    V di = S::set1(T(0));
+    V norm = S::set1(T(0));
+    V dnorm = S::set1(T(0));
+    typename S::Count n = S::count_zero();
+    if (!check) {
+      iterate_distance<S, Power, Julia, false>(cr, ci, dx, 0, view.limit, x, y, dr, di,
+                                               n, alive, done, norm, dnorm);
+    } else if (iterate_distance<S, Power, Julia, false>(cr, ci, dx, 0, warmup, x, y, dr, di,
+                                                        n, alive, done, norm, dnorm)) {
+      iterate_distance<S, Power, Julia, true>(cr, ci, dx, warmup, view.limit, x, y, dr, di,
+                                              n, alive, done, norm, dnorm);
+    }
+
+    int tail[S::width];
+    float tail_norms[S::width];
+    float tail_dnorms[S::width];
+    S::store(n, tail);
+    S::store_float(norm, tail_norms);
+    S::store_float(dnorm, tail_dnorms);
+    int inside = S::bits(interior);
+    int stopped = S::bits(done);
+    check = false;
+    for (int k = 0; k < S::width && p + k < x2; ++k) {
+      int q = p - x1 + k;
+      if ((stopped & ~inside) >> k & 1)
+        saved += view.limit - tail[k];
+      counts[q] = (stopped >> k) & 1 ? view.limit : tail[k];
+      norms[q] = counts[q] < view.limit ? tail_norms[k] : 0;
+      distances[q] = counts[q] < view.limit ? distance_estimate(tail_norms[k], tail_dnorms[k]) : 0;
+      check = check || counts[q] == view.limit;
+    }
+  }
+  return saved;
+}
+
+template <class S, int Power>
+int row_distance_power(const View<typename S::T> & view, int j, int x1, int x2, int * counts,
+                       float * norms, float * distances)
+{
+  if (view.julia)
+    return row_distance_multibrot<S, Power, true>(view, j, x1, x2, counts, norms, distances);
+  return row_distance_multibrot<S, Power, false>(view, j, x1, x2, counts, norms, distances);
+}
+
+/// Distance kernel for the power of the view, picked once per row.  Formulas
+/// other than Multibrot go to row_simd(), with every distance 0.
+template <class S>
+int row_distance(const View<typename S::T> & view, int j, int x1, int x2, int * counts,
+                 float * norms, float * distances)
+{
+  if (view.formula != FORMULA_MULTIBROT) {
+    for (int p = x1; p < x2; ++p)
+      distances[p - x1] = 0;
+    return row_simd<S>(view, j, x1, x2, counts, norms);
+  }
+  switch (view.power) {
+  case 3:
+    return row_distance_power<S, 3>(view, j, x1, x2, counts, norms, distances);
+  case 4:
+    return row_distance_power<S, 4>(view, j, x1, x2, counts, norms, distances);
+  case 5:
+    return row_distance_power<S, 5>(view, j, x1, x2, counts, norms, distances);
+  case 6:
+    return row_distance_power<S, 6>(view, j, x1, x2, counts, norms, distances);
+  case 7:
+    return row_distance_power<S, 7>(view, j, x1, x2, counts, norms, distances);
+  case 8:
+    return row_distance_power<S, 8>(view, j, x1, x2, counts, norms, distances);
+  default:
+    return row_distance_power<S, 2>(view, j, x1, x2, counts, norms, distances);
+  }
+}
+
+/// Newton kernel for one degree, S::width pixels at once.  The coefficients
+/// are broadcast once per row.  Lanes leave the mask as they converge, but
+/// keep stepping with the rest, which leaves them on their root.
+template <class S, int Degree>
+void newton_simd_degree(const View<typename S::T> & view, const Polynomial<typename S::T> & poly,
+                        int j, int x1, int x2, int * counts, int * roots)
+{
+  typedef typename S::T T;
+  typedef typename S::V V;
+  typedef typename S::Mask Mask;
+  V ar[Degree + 1];
+  V ai[Degree + 1];
+  for (int k = 0; k <= Degree; ++k) {
+    ar[k] = S::set1(poly.ar[k]);
+    ai[k] = S::set1(poly.ai[k]);
+  }
+  const V one = S::set1(T(1));
+  const V tolerance = S::set1(T(NEWTON_TOLERANCE));
+  const V lanes = S::index();
+  const V cx = S::set1(view.cx);
+  const V dx = S::set1(view.scale / T(view.width));
+  const V py = S::set1(view.cy + T(j - view.height / 2) * (view.scale / T(view.height)));
+
+  for (int p = x1; p < x2; p += S::width) {
+    V x = S::add(cx, S::mul(S::add(S::set1(T(p - view.width / 2)), lanes), dx));
+    V y = py;
+    Mask alive = S::mask_all();
+    typename S::Count n = S::count_zero();
+    for (int i = 0; i < view.limit; ++i) {
+      V sr, si;
+      NewtonStep<S, Degree>::apply(ar, ai, one, x, y, sr, si);
+      n = S::count_inc(n, alive);
+      alive = S::mask_andnot(alive, S::lt(S::fmadd(sr, sr, S::mul(si, si)), tolerance));
+      if (!S::any(alive))
+        break;
+    }
+
+    int tail[S::width];
+    float tail_x[S::width];
+    float tail_y[S::width];
+    S::store(n, tail);
+    S::store_float(x, tail_x);
+    S::store_float(y, tail_y);
+    int converged = ~S::bits(alive);
+    for (int k = 0; k < S::width && p + k < x2; ++k) {
+      bool done = (converged >> k) & 1;
+      counts[p - x1 + k] = done ? tail[k] : view.limit;
+      roots[p - x1 + k] = done ? nearest_root(poly, T(tail_x[k]), T(tail_y[k])) : -1;
+    }
+  }
+}
+
+/// newton_simd_degree() for the degree of the polynomial, picked once per row.
+template <class S>
+void newton_simd(const View<typename S::T> & view, const Polynomial<typename S::T> & poly,
+                 int j, int x1, int x2, int * counts, int * roots)
+{
+  switch (poly.degree) {
+  case 2:
+    return newton_simd_degree<S, 2>(view, poly, j, x1, x2, counts, roots);
+  case 3:
+    return newton_simd_degree<S, 3>(view, poly, j, x1, x2, counts, roots);
+  case 4:
+    return newton_simd_degree<S, 4>(view, poly, j, x1, x2, counts, roots);
+  case 5:
+    return newton_simd_degree<S, 5>(view, poly, j, x1, x2, counts, roots);
+  case 6:
+    return newton_simd_degree<S, 6>(view, poly, j, x1, x2, counts, roots);
+  case 7:
+    return newton_simd_degree<S, 7>(view, poly, j, x1, x2, counts, roots);
+  default:
+    return newton_simd_degree<S, 8>(view, poly, j, x1, x2, counts, roots);
+  }
+}
+
+/// Loads S::width values from a + p, padding past count with zeros.
+template <class S>
+typename S::V load_tail(const typename S::T * a, int p, int count)
+{
+  if (count - p >= S::width)
+    return S::load(a + p);
+  typename S::T tail[S::width];
+  for (int k = 0; k < S::width; ++k)
+    tail[k] = p + k < count ? a[p + k] : 0;
+  return S::load(tail);
+}
+
+/// Perturbation kernel, S::width pixels at once.  Every lane steps through the
+/// reference orbit together, so Z_n is a broadcast rather than a gather.
+/// S must be a double wrapper.
+template <class S>
+void delta_simd(const Orbit & orbit, int limit, int start,
+                const double * dcr, const double * dci,
+                const double * d0r, const double * d0i,
+                int count, int * counts, float * norms)
+{
+  typedef typename S::V V;
+  typedef typename S::Mask Mask;
+  const V four = S::set1(4.0);
+  const V zero = S::set1(0.0);
+  int steps = limit < orbit.length ? limit : orbit.length;
+
+  for (int p = 0; p < count; p += S::width) {
+    V cr = load_tail<S>(dcr, p, count);
+    V ci = load_tail<S>(dci, p, count);
+    V dr = d0r ? load_tail<S>(d0r, p, count) : zero;
+    V di = d0i ? load_tail<S>(d0i, p, count) : zero;
+    Mask alive = S::mask_all();
+    Mask glitched = S::mask_none();
+    V norm = zero;
+    typename S::Count n = S::count_zero();
+    int i = start;
+    for (; i < steps; ++i) {
+      double Zr = orbit.zr[i];
+      double Zi = orbit.zi[i];
+      V zr = S::add(S::set1(Zr), dr);
+      V zi = S::add(S::set1(Zi), di);
+      V r2 = S::fmadd(zr, zr, S::mul(zi, zi));
+      norm = S::select(alive, r2, norm);
+      alive = S::mask_and(alive, S::lt(r2, four));
+      Mask bad = S::mask_and(alive, S::lt(r2, S::set1(GLITCH_TOLERANCE * (Zr*Zr + Zi*Zi))));
+      glitched = S::mask_or(glitched, bad);
+      alive = S::mask_andnot(alive, bad);
+      if (!S::any(alive))
+        break;
+      n = S::count_inc(n, alive);
+
+      V zrv = S::set1(Zr);
+      V ziv = S::set1(Zi);
+      V t = S::fmsub(zrv, dr, S::mul(ziv, di));
+      V u = S::fmadd(zrv, di, S::mul(ziv, dr));
+      V dr2 = S::add(S::add(t, t), S::add(S::fmsub(dr, dr, S::mul(di, di)), cr));
+      di = S::add(S::add(u, u), S::fmadd(S::add(dr, dr), di, ci));
+      dr = dr2;
+    }
+    if (i == steps && steps < limit)
+      glitched = S::mask_or(glitched, alive);
+
+    int tail[S::width];
+    float tail_norms[S::width];
+    S::store(n, tail);
+    S::store_float(norm, tail_norms);
+    int bits = S::bits(glitched);
+    for (int k = 0; k < S::width && p + k < count; ++k) {
+      counts[p + k] = (bits >> k) & 1 ? GLITCHED : start + tail[k];
+      norms[p + k] = counts[p + k] < limit ? tail_norms[k] : 0;
+    }
+  }
+}
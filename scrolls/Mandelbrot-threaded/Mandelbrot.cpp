@@ -4,107 +4,400 @@
 */
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
 #include <string>
+#include <cstring>
 #include "Mandelbrot.h"
+#include "Julia.h"
+#include "Newton.h"
+#include "Buddhabrot.h"
 using namespace std;
 
-Mandelbrot::Mandelbrot(int width, int height)
-  : TextureRenderer(width, height) 
+Mandelbrot::Mandelbrot(int width, int height, const KernelSet & kernels, bool perturb, bool series,
+                       TileOrder order)
+  : TextureRenderer(width, height),
+    scheduler((width + TILE_SIZE - 1) / TILE_SIZE, (height + TILE_SIZE - 1) / TILE_SIZE,
+              TILE_SIZE, order)
 {
-  this->limit = 64;
-  this->scale = 3.0f;
-  this->tx = -width * 5 / 7.0f;
-  this->ty = -height / 2.0f;
+  this->view.limit = 64;
+  this->view.scale = 3.0;
+  this->view.cx = -9 / 14.0;
+  this->view.cy = 0.0;
+  this->view.width = width;
+  this->view.height = height;
+  this->view.formula = FORMULA_MULTIBROT;
+  this->view.power = 2;
+  this->view.julia = false;
+  this->view.jr = 0.0;
+  this->view.ji = 0.0;
+  this->precision = PRECISION_COUNT;
+  this->kernels = &kernels;
+  this->perturb = perturb;
+  this->series = series;
+  this->deep = false;
+  this->saved = 0;
+  this->report = true;
+  this->tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+  this->tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+  /// Each tile is one run of the buffers, in row order within it, and the
+  /// runs follow one another in the scheduler's order.
+  int tiles = tiles_x * tiles_y;
+  vector<int> in_order(tiles);
+  for (int t = 0; t < tiles; ++t)
+    in_order[scheduler.slot(t)] = t;
+  this->tile_first.resize(tiles);
+  for (int i = 0, first = 0; i < tiles; ++i) {
+    int t = in_order[i];
+    int w = min((int)TILE_SIZE, width - t % tiles_x * TILE_SIZE);
+    int h = min((int)TILE_SIZE, height - t / tiles_x * TILE_SIZE);
+    tile_first[t] = first;
+    first += w * h;
+  }
+  this->counts = new int[width * height];
+  this->norms = new float[width * height];
+  this->distances = new float[width * height];
+  this->colouring = COLOURING_BANDS;
+  update_view();
 }
 
 Mandelbrot::~Mandelbrot()
 {
+  delete[] counts;
+  delete[] norms;
+  delete[] distances;
 }
 
-float Mandelbrot::pixel_at(float cr, float ci)
+/// The buffers are tile by tile, so each worker's slice holds whole tiles,
+/// which TileScheduler hands to workers on the same node first.
+void Mandelbrot::place_buffers()
 {
-  float x = 0, y = 0;
-  float tmp;
-  int i = 0;
-  while ((x*x + y*y < 4) && (i++ < limit)) {
-      tmp = x*x - y*y + cr;
-      y = 2 * x * y + ci;
-      x = tmp;
-  }
-  if (i >= limit)
-    return 0.0f;
-  return i / (float)(limit);
+  TextureRenderer::place_buffers();
+  pool->first_touch(counts, width * height * sizeof(int));
+  pool->first_touch(norms, width * height * sizeof(float));
+  pool->first_touch(distances, width * height * sizeof(float));
 }
 
-void Mandelbrot::thread_action(int index)
+void Mandelbrot::compute_frame()
 {
-  BBox bbox(0, 0, width, height);
-  int block_height = height / thread_count;
-  if (index + 1 < thread_count) {
-    bbox.y1 = (block_height * index);
-    bbox.y2 = (block_height * (index+1));
-  } else {
-    bbox.y1 = (block_height * index);
-    bbox.y2 = height;
-  }
-  while (running) {
-    for (int j = bbox.y1; j < bbox.y2; ++j) {
-      for (int i = bbox.x1; i < bbox.x2; ++i) {  
-        float x = (float)(i + tx) / width * scale;
-        float y = (float)(j + ty) / height * scale;
-        unsigned char value = (unsigned char)(pixel_at(x, y) * 255);
-#ifdef DEBUG
-        if (j == bbox.y1) {
-          data[j*height*3+i*3] = 255;
-          data[j*height*3+1+i*3] = 0;
-          data[j*height*3+2+i*3] = 0;
-        } else {
-#endif
-          data[j*height*3+i*3] = value;
-          data[j*height*3+1+i*3] = value >> 1;
-          data[j*height*3+2+i*3] = value >> 2;
+  /// Perturbation has no distance kernel, so deep views colour smoothly.
+  Colouring c = colouring == COLOURING_DISTANCE && deep ? COLOURING_SMOOTH : colouring;
+  scheduler.run(*pool, [this, c](int t, int r1, int r2) { compute_tile(t, r1, r2, c); },
+                [this]() { return cancelled(); });
+}
+
+void Mandelbrot::compute_tile(int t, int r1, int r2, Colouring c)
+{
+  BBox tile(t % tiles_x * TILE_SIZE, t / tiles_x * TILE_SIZE, 0, 0);
+  tile.x2 = tile.x1 + TILE_SIZE < width ? tile.x1 + TILE_SIZE : width;
+  tile.y2 = tile.y1 + TILE_SIZE < height ? tile.y1 + TILE_SIZE : height;
+  /// Tiles on the bottom edge may have fewer rows than asked for.
+  BBox bbox(tile.x1, tile.y1 + r1, tile.x2, tile.y1 + r2);
+  if (bbox.y2 > tile.y2)
+    bbox.y2 = tile.y2;
+  if (bbox.y1 >= bbox.y2)
+    return;
+  int w = bbox.x2 - bbox.x1;
+  int first = tile_first[t] + r1 * w;
+  float * tile_distances = c == COLOURING_DISTANCE ? distances + first : NULL;
+  saved += compute(bbox, counts + first, norms + first, tile_distances);
+  for (int j = bbox.y1; j < bbox.y2; ++j) {
+    int k = first + (j - bbox.y1) * w;
+    colour_pixels(counts + k, norms + k, tile_distances ? distances + k : NULL, w,
+                  view.limit, view.power, c, data + 3 * (j * width + bbox.x1));
+  }
 #ifdef DEBUG
-        }
+  for (int i = bbox.x1; i < bbox.x2; ++i) {
+    data[bbox.y1*width*3+i*3] = 255;
+    data[bbox.y1*width*3+1+i*3] = 0;
+    data[bbox.y1*width*3+2+i*3] = 0;
+  }
 #endif
-      }
+}
+
+long Mandelbrot::compute(const BBox & bbox, int * counts, float * norms, float * distances)
+{
+  if (deep) {
+    perturbation.render(bbox.x1, bbox.y1, bbox.x2, bbox.y2, counts, norms);
+    return 0;
+  }
+  int w = bbox.x2 - bbox.x1;
+  long band_saved = 0;
+  for (int j = bbox.y1; j < bbox.y2; ++j) {
+    int k = (j - bbox.y1) * w;
+    band_saved += compute_row(j, bbox.x1, bbox.x2, counts + k, norms + k,
+                              distances ? distances + k : NULL);
+  }
+  return band_saved;
+}
+
+int Mandelbrot::compute_row(int j, int x1, int x2, int * counts, float * norms, float * distances)
+{
+  if (distances) {
+    switch (precision) {
+    case PRECISION_FLOAT:
+      return kernels->distance_float(view_float, j, x1, x2, counts, norms, distances);
+    case PRECISION_DOUBLE:
+      return kernels->distance_double(view_double, j, x1, x2, counts, norms, distances);
+    case PRECISION_LONG_DOUBLE:
+      return kernels->distance_long_double(view_long_double, j, x1, x2, counts, norms, distances);
+    default:
+      return kernels->distance_double_double(view_double_double, j, x1, x2, counts, norms,
+                                             distances);
     }
-    thread_signal_and_wait();
+  }
+  switch (precision) {
+  case PRECISION_FLOAT:
+    return kernels->row_float(view_float, j, x1, x2, counts, norms);
+  case PRECISION_DOUBLE:
+    return kernels->row_double(view_double, j, x1, x2, counts, norms);
+  case PRECISION_LONG_DOUBLE:
+    return kernels->row_long_double(view_long_double, j, x1, x2, counts, norms);
+  default:
+    return kernels->row_double_double(view_double_double, j, x1, x2, counts, norms);
   }
 }
 
+void Mandelbrot::update_view()
+{
+  Precision p = precision_for(view_as<double>(view));
+  /// Perturbation, and the series with it, is worked out for the Mandelbrot
+  /// set of z^2 + c only.
+  bool d = perturb && p > PRECISION_DOUBLE && view.formula == FORMULA_MULTIBROT
+          && view.power == 2 && !view.julia;
+  /// Without perturbation there are no kernels past double-double.
+  if (!d && p > PRECISION_DOUBLE_DOUBLE)
+    p = PRECISION_DOUBLE_DOUBLE;
+  if (p != precision || d != deep) {
+    if (d)
+      cout << "Switching to perturbation from a "
+           << precision_name(p > PRECISION_DOUBLE_DOUBLE ? p : PRECISION_DOUBLE_DOUBLE)
+           << " reference" << endl;
+    else
+      cout << "Switching to " << precision_name(p) << " precision" << endl;
+  }
+  precision = p;
+  deep = d;
+  if (deep) {
+    int skipped = perturbation.skipped();
+    perturbation.prepare(view, precision, kernels, series);
+    if (perturbation.skipped() != skipped)
+      cout << "Series approximation skips " << perturbation.skipped() << " iterations" << endl;
+    return;
+  }
+  view_float = view_as<float>(view);
+  view_double = view_as<double>(view);
+  view_long_double = view_as<long double>(view);
+  view_double_double = view_as<DoubleDouble>(view);
+}
+
+/// Frames the whole set of the formula and power of the view.  A Julia set
+/// lies within |Z| <= 2, as the orbit of anything further out escapes.
+static void frame_whole_set(View<Fixed1024> & view)
+{
+  view.scale = view.julia ? 4.0 : 3.0;
+  view.cx = 0.0;
+  view.cy = 0.0;
+  if (view.power != 2 || view.julia)
+    return;
+  if (view.formula == FORMULA_MULTIBROT) {
+    view.cx = -9 / 14.0;
+  } else if (view.formula == FORMULA_BURNING_SHIP) {
+    view.scale = 3.5;
+    view.cx = -0.4;
+  }
+}
+
+void Mandelbrot::frame_home()
+{
+  view.scale = 2.0;
+  view.cx = -1 / 3.0;
+  view.cy = 1 / 3.0;
+}
+
+/// Clamps a to [lo, hi].
+static void clamp(Fixed1024 & a, double lo, double hi)
+{
+  double d = to_double(a);
+  if (d < lo)
+    a = lo;
+  else if (d > hi)
+    a = hi;
+}
+
+bool Mandelbrot::view_input()
+{
+  const char * keys = "HWASDQE[]";
+  for (int i = 0; keys[i]; ++i)
+    if (glfwGetKey(keys[i]) == GLFW_PRESS)
+      return true;
+  for (int p = MIN_POWER; p <= MAX_POWER; ++p)
+    if (glfwGetKey('0' + p) == GLFW_PRESS && view.power != p)
+      return true;
+  for (int f = 0; f < FORMULA_COUNT; ++f)
+    if (glfwGetKey(GLFW_KEY_F1 + f) == GLFW_PRESS && view.formula != f)
+      return true;
+  return (glfwGetKey('C') == GLFW_PRESS && colouring != COLOURING_SMOOTH)
+         || (glfwGetKey('B') == GLFW_PRESS && colouring != COLOURING_BANDS)
+         || (glfwGetKey('O') == GLFW_PRESS && colouring != COLOURING_DISTANCE);
+}
+
 void Mandelbrot::handle_inputs()
 {
   TextureRenderer::handle_inputs();
-  if (glfwGetKey('H') == GLFW_PRESS) {
-    scale = 2.f;
-    tx = -width * 2 / 3.0f;
-    ty = -height / 3.0f;
-  }
+  /// Report on the first frame of every view, so the gain can be checked
+  /// view by view without a line every frame.  A cancelled frame only did
+  /// part of the work, so the report waits for the next.
+  if (report && finished && !deep)
+    cout << "Periodicity checking saved " << saved << " iterations, "
+         << saved / (double)(width * height) << " per pixel" << endl;
+  if (report && finished)
+    cout << "Load imbalance " << scheduler.imbalance() << endl;
+  bool unreported = report && !finished;
+  report = false;
+  saved = 0;
+  View<Fixed1024> last = view;
+  if (glfwGetKey('H') == GLFW_PRESS)
+    frame_home();
+  /// Pan by a sixteenth of the frame, and zoom by a constant factor, so both
+  /// feel the same at any depth.
+  Fixed1024 step = view.scale * 0.0625;
   if (glfwGetKey('W') == GLFW_PRESS)
-    ty -= height >> 4;
+    view.cy -= step;
   if (glfwGetKey('A') == GLFW_PRESS)
-    tx += width >> 4;
+    view.cx += step;
   if (glfwGetKey('S') == GLFW_PRESS)
-    ty += height >> 4;
+    view.cy += step;
   if (glfwGetKey('D') == GLFW_PRESS)
-    tx -= width >> 4;
+    view.cx -= step;
   if (glfwGetKey('Q') == GLFW_PRESS)
-    scale += 0.25f;
+    view.scale *= 1.25;
   if (glfwGetKey('E') == GLFW_PRESS)
-    scale -= 0.25f;
+    view.scale *= 0.8;
+  /// Number keys pick the power and F1 onwards the formula, and either frames
+  /// the whole set when it changes.
+  for (int p = MIN_POWER; p <= MAX_POWER; ++p) {
+    if (glfwGetKey('0' + p) == GLFW_PRESS && view.power != p) {
+      view.power = p;
+      frame_whole_set(view);
+    }
+  }
+  for (int f = 0; f < FORMULA_COUNT; ++f) {
+    if (glfwGetKey(GLFW_KEY_F1 + f) == GLFW_PRESS && view.formula != f) {
+      view.formula = f;
+      frame_whole_set(view);
+      cout << "Drawing the " << formula_name((Formula)f) << " formula" << endl;
+    }
+  }
+  if (glfwGetKey('C') == GLFW_PRESS)
+    colouring = COLOURING_SMOOTH;
+  if (glfwGetKey('B') == GLFW_PRESS)
+    colouring = COLOURING_BANDS;
+  if (glfwGetKey('O') == GLFW_PRESS)
+    colouring = COLOURING_DISTANCE;
   if (glfwGetKey('[') == GLFW_PRESS) {
-    limit /= 2;
-    if (limit < 1) limit = 2;
+    view.limit /= 2;
+    if (view.limit < 1) view.limit = 2;
   }
   if (glfwGetKey(']') == GLFW_PRESS) {
-    limit *= 2;
-    if (limit > 1024) limit = 1024;
+    view.limit *= 2;
+    if (view.limit > 1024) view.limit = 1024;
   }
+  /// Fixed point only holds [-8, 8), and the delta kernels work in double, so
+  /// keep the view well inside both.
+  clamp(view.scale, 1e-290, 4);
+  clamp(view.cx, -4, 4);
+  clamp(view.cy, -4, 4);
+  view_changed = !same_view(view, last);
+  report = view_changed || unreported;
+  update_view();
 }
 
+/// Usage: Mandelbrot [--kernel scalar|sse2|avx2|avx512] [--no-perturbation]
+///                   [--no-series]
+///                   [--julia | --newton | --buddhabrot] [--workers N] [--pin]
+///                   [--tile-order cost|rows|morton|hilbert]
+///
+/// By default the widest kernel this machine supports is used.  --kernel
+/// forces a narrower one, e.g. to compare them against each other.
+/// --no-perturbation iterates every pixel in full precision on deep views.
+/// --no-series iterates every perturbed pixel from the start.
+/// --julia explores Julia sets instead (see Julia.h), --newton the basins of
+/// Newton's method (see Newton.h), and --buddhabrot the density of escaping
+/// orbits (see Buddhabrot.h).
+///
+/// There is one worker per processor this program may use (see cpu_count()),
+/// and while it runs it looks for the number of them that computes frames
+/// fastest.  --workers fixes the number instead.  --pin pins every worker to
+/// a processor, so that each works mostly on memory of its own NUMA node; the
+/// processors and nodes are printed at startup.
+///
+/// --tile-order picks the order Mandelbrot hands out its tiles in, and keeps
+/// them in memory in, for Mandelbrot and Julia: the most expensive first, the
+/// default, or along a row, Morton or Hilbert curve (see TileScheduler.h).
 int main(int argc, char* argv[])
 {    
-  Mandelbrot m(1024, 1024);
-  m.start_threaded(256);
+  Isa isa = cpu_detect();
+  bool perturb = true;
+  bool series = true;
+  bool julia = false;
+  bool newton = false;
+  bool buddhabrot = false;
+  int workers = 0;
+  bool pin = false;
+  TileOrder order = ORDER_COST;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+      Isa forced = isa_parse(argv[++i]);
+      if (forced == ISA_COUNT)
+        cout << "Unknown kernel " << argv[i] << endl;
+      else if (forced > isa)
+        cout << "This machine does not support " << isa_name(forced) << endl;
+      else
+        isa = forced;
+    } else if (strcmp(argv[i], "--no-perturbation") == 0) {
+      perturb = false;
+    } else if (strcmp(argv[i], "--no-series") == 0) {
+      series = false;
+    } else if (strcmp(argv[i], "--julia") == 0) {
+      julia = true;
+    } else if (strcmp(argv[i], "--newton") == 0) {
+      newton = true;
+    } else if (strcmp(argv[i], "--buddhabrot") == 0) {
+      buddhabrot = true;
+    } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+      workers = atoi(argv[++i]);
+      if (workers < 1)
+        cout << "Need at least 1 worker, not " << argv[i] << endl;
+    } else if (strcmp(argv[i], "--pin") == 0) {
+      pin = true;
+    } else if (strcmp(argv[i], "--tile-order") == 0 && i + 1 < argc) {
+      TileOrder o = order_parse(argv[++i]);
+      if (o == ORDER_COUNT)
+        cout << "Unknown tile order " << argv[i] << endl;
+      else
+        order = o;
+    }
+  }
+  const KernelSet & kernels = kernels_for(isa);
+  cout << "Using the " << isa_name(isa) << " kernels" << endl;
+
+  print_topology(cpu_topology());
+  bool tune = workers < 1;
+  if (tune)
+    workers = cpu_count();
+
+  if (buddhabrot) {
+    Buddhabrot m(1024, 1024, workers);
+    m.start_threaded(workers, tune, pin);
+  } else if (newton) {
+    Newton m(1024, 1024, kernels);
+    m.start_threaded(workers, tune, pin);
+  } else if (julia) {
+    Julia m(1024, 1024, kernels, order);
+    m.start_threaded(workers, tune, pin);
+  } else {
+    Mandelbrot m(1024, 1024, kernels, perturb, series, order);
+    m.start_threaded(workers, tune, pin);
+  }
   return 0;
 }
@@ -3,6 +3,10 @@
 ///
 #pragma once
 #include "TextureRenderer.h"
+#include "Kernels.h"
+#include "Perturbation.h"
+#include "TileScheduler.h"
+#include "Colouring.h"
   
 /**
  * rendering bounding box region
@@ -36,28 +40,91 @@ struct BBox {
 ///
 class Mandelbrot : public TextureRenderer
 {
-  int limit;              /// Upper bound number of computing interations per pixel
-  float scale;            /// Global scale of the renderer
-  float tx;               /// Global translation on x axis
-  float ty;               /// Global translation on y axis
+protected:
+  View<Fixed1024> view;      /// Iteration limit, zoom and centre of the renderer
+
+private:
+  Precision precision;       /// Number type the current frame is computed in
+  View<float> view_float;    /// view rounded to each precision; see update_view()
+  View<double> view_double;
+  View<long double> view_long_double;
+  View<DoubleDouble> view_double_double;
+  const KernelSet * kernels; /// Kernels for the instruction set picked at startup
+  bool perturb;              /// Whether deep views may use perturbation
+  bool series;               /// Whether perturbation may skip iterations by series approximation
+  bool deep;                 /// Whether the current frame uses perturbation
+  Perturbation perturbation;
+  std::atomic<long> saved;   /// Iterations the periodicity check saved this frame
+  bool report;               /// Whether to print saved after this frame
+  int tiles_x, tiles_y;      /// Number of tiles across and down the frame
+  TileScheduler scheduler;   /// Orders the tiles by what they took the frame before
+  std::vector<int> tile_first; /// Where each tile starts in the buffers below
+  int * counts;              /// Raw kernel output for the frame, one entry per pixel, tile
+  float * norms;             /// by tile in the scheduler's order; coloured into data by colour_pixels()
+  float * distances;         /// Distance estimates, only computed for COLOURING_DISTANCE
+  Colouring colouring;
 
 public:
-  Mandelbrot(int width, int height);
+  /// Side of the square tiles the frame is cut into, in pixels.
+  enum { TILE_SIZE = 32 };
+
+  /// Renders with the given kernels, which must be supported by this machine
+  /// (see cpu_detect() and kernels_for()).
+  /// Views deeper than double go through perturbation unless perturb is
+  /// false, using the series approximation unless series is false.  Tiles
+  /// are handed out and kept in memory in the given order.
+  Mandelbrot(int width, int height, const KernelSet & kernels, bool perturb, bool series,
+             TileOrder order);
   virtual ~Mandelbrot();
 
 private:
-  /// Returns the pixel intensity at imaginary plane (cr, ci)
+  /// Threaded mandlebrot rendering function.
   /// The Mandelbrot fractal is embarrassingly parallel---one could compute it
-  /// pixel by pixel with no interference.  The formula is simple and implemented below.
-  /// This function returns the fractal at (cr, ci) in the range [0, 1]
-  float pixel_at(float cr, float ci); 
+  /// pixel by pixel with no interference.  Each row is handed to a row kernel
+  /// (see Kernels.h), which may work on several pixels at once.
+  ///
+  /// Pixels inside the set take the full limit and the rest far less, so
+  /// fixed bands of rows leave the threads that miss the set waiting on the
+  /// ones that cross it.  Instead the frame is cut into small tiles, which
+  /// the workers take the most expensive first (see TileScheduler), and the
+  /// frame takes about its total work over the number of workers.
+  void compute_frame();
 
-  /// Threaded mandlebrot rendering function.
-  void thread_action(int index);
+  /// Computes and colours rows [r1, r2) of tile t of the frame, counting
+  /// tiles row by row and rows from the top of the tile.
+  void compute_tile(int t, int r1, int r2, Colouring c);
+
+  /// Computes the escape counts and norms of the pixels in bbox, row by row,
+  /// and distance estimates too unless distances is NULL.  Returns the
+  /// iterations the periodicity check saved.
+  long compute(const BBox & bbox, int * counts, float * norms, float * distances);
 
-  /// Grabs user inputs and provides feedback
-  void handle_inputs();
+  /// Computes the escape counts and norms of pixels [x1, x2) on row j with
+  /// the kernel for the current precision, or with the distance kernel unless
+  /// distances is NULL.  Returns the iterations saved.
+  int compute_row(int j, int x1, int x2, int * counts, float * norms, float * distances);
 
+protected:
+  /// Picks the precision for the current view, and rounds the view to it, or
+  /// computes the reference orbit if it is deep enough for perturbation.
+  /// Only called between frames, so the workers never see it change.
+  void update_view();
+
+  /// Grabs user inputs and provides feedback.  Subclasses that change the view
+  /// should do so before calling this, which rounds it for the next frame.
+  virtual void handle_inputs();
+
+  /// Whether a key that pans, zooms or changes the limit is down, or one
+  /// that picks another power, formula or colouring.
+  virtual bool view_input();
+
+  /// Moves the view to where H takes it.
+  virtual void frame_home();
+
+  /// Spreads the kernel output buffers over the workers, like data.
+  void place_buffers();
+
+private:
   /// No multi-threading drawing method
   void draw();
 };
\ No newline at end of file
@@ -0,0 +1,154 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <iostream>
+#include <cmath>
+#include "Newton.h"
+using namespace std;
+
+Newton::Newton(int width, int height, const KernelSet & kernels)
+  : TextureRenderer(width, height)
+{
+  this->view.limit = 64;
+  this->view.scale = 3.0;
+  this->view.cx = 0.0;
+  this->view.cy = 0.0;
+  this->view.width = width;
+  this->view.height = height;
+  this->view.formula = FORMULA_MULTIBROT;
+  this->view.power = 2;
+  this->view.julia = false;
+  this->view.jr = 0.0;
+  this->view.ji = 0.0;
+  this->precision = PRECISION_COUNT;
+  this->kernels = &kernels;
+  this->counts = new int[width * height];
+  this->roots = new int[width * height];
+  this->grabbed = -1;
+  roots_of_unity(3);
+  update_view();
+}
+
+Newton::~Newton()
+{
+  delete[] counts;
+  delete[] roots;
+}
+
+void Newton::compute_frame()
+{
+  pool->parallel_for(0, height, 1, [this](int j) {
+    if (cancelled())
+      return;
+    int first = j * width;
+    compute_row(j, 0, width, counts + first, roots + first);
+    colour_roots(counts + first, roots + first, width, view.limit, data + 3 * first);
+  });
+}
+
+void Newton::place_buffers()
+{
+  TextureRenderer::place_buffers();
+  pool->first_touch(counts, width * height * sizeof(int));
+  pool->first_touch(roots, width * height * sizeof(int));
+}
+
+void Newton::compute_row(int j, int x1, int x2, int * counts, int * roots)
+{
+  if (precision == PRECISION_FLOAT)
+    kernels->newton_float(view_float, poly_float, j, x1, x2, counts, roots);
+  else
+    kernels->newton_double(view, poly, j, x1, x2, counts, roots);
+}
+
+void Newton::roots_of_unity(int degree)
+{
+  const double pi = 3.14159265358979323846;
+  poly.degree = degree;
+  for (int k = 0; k < degree; ++k) {
+    poly.rr[k] = cos(2 * pi * k / degree);
+    poly.ri[k] = sin(2 * pi * k / degree);
+  }
+}
+
+void Newton::update_view()
+{
+  expand_roots(poly);
+  /// There are no Newton kernels past double, and the view stops short of it.
+  Precision p = precision_for(view);
+  if (p > PRECISION_FLOAT)
+    p = PRECISION_DOUBLE;
+  if (p != precision)
+    cout << "Switching to " << precision_name(p) << " precision" << endl;
+  precision = p;
+  view_float = view_as<float>(view);
+  poly_float = polynomial_as<float>(poly);
+}
+
+bool Newton::view_input()
+{
+  const char * keys = "HWASDQE[]";
+  for (int i = 0; keys[i]; ++i)
+    if (glfwGetKey(keys[i]) == GLFW_PRESS)
+      return true;
+  for (int n = MIN_DEGREE; n <= MAX_DEGREE; ++n)
+    if (glfwGetKey('0' + n) == GLFW_PRESS && poly.degree != n)
+      return true;
+  return glfwGetMouseButton(GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+}
+
+void Newton::handle_inputs()
+{
+  TextureRenderer::handle_inputs();
+  View<double> last = view;
+  Polynomial<double> last_poly = poly;
+  if (glfwGetKey('H') == GLFW_PRESS) {
+    view.scale = 3.0;
+    view.cx = 0.0;
+    view.cy = 0.0;
+  }
+  double step = view.scale * 0.0625;
+  if (glfwGetKey('W') == GLFW_PRESS)
+    view.cy -= step;
+  if (glfwGetKey('A') == GLFW_PRESS)
+    view.cx += step;
+  if (glfwGetKey('S') == GLFW_PRESS)
+    view.cy += step;
+  if (glfwGetKey('D') == GLFW_PRESS)
+    view.cx -= step;
+  if (glfwGetKey('Q') == GLFW_PRESS)
+    view.scale *= 1.25;
+  if (glfwGetKey('E') == GLFW_PRESS)
+    view.scale *= 0.8;
+  if (glfwGetKey('[') == GLFW_PRESS) {
+    view.limit /= 2;
+    if (view.limit < 1) view.limit = 2;
+  }
+  if (glfwGetKey(']') == GLFW_PRESS) {
+    view.limit *= 2;
+    if (view.limit > 1024) view.limit = 1024;
+  }
+  for (int n = MIN_DEGREE; n <= MAX_DEGREE; ++n) {
+    if (glfwGetKey('0' + n) == GLFW_PRESS && poly.degree != n)
+      roots_of_unity(n);
+  }
+  /// Rows of the texture count up from the bottom of the window, the mouse
+  /// down from the top.
+  if (glfwGetMouseButton(GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+    int mx, my;
+    glfwGetMousePos(&mx, &my);
+    double x = view.cx + (mx - width / 2) * (view.scale / width);
+    double y = view.cy + (height - 1 - my - height / 2) * (view.scale / height);
+    if (grabbed < 0)
+      grabbed = nearest_root(poly, x, y);
+    poly.rr[grabbed] = x;
+    poly.ri[grabbed] = y;
+  } else {
+    grabbed = -1;
+  }
+  /// Keep to what double resolves, and to where the roots are.
+  if (view.scale < 1e-12)
+    view.scale = 1e-12;
+  if (view.scale > 16)
+    view.scale = 16;
+  view_changed = !same_view(view, last) || !same_polynomial(poly, last_poly);
+  update_view();
+}
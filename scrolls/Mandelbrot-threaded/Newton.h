@@ -0,0 +1,59 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Newton fractals: the basins of attraction of the roots of a polynomial
+/// under Newton's method, on the same threads and frame buffer as Mandelbrot.
+#pragma once
+#include "TextureRenderer.h"
+#include "Kernels.h"
+#include "Colouring.h"
+
+/// Every pixel starts Newton's method at its own point of the complex plane,
+/// and is coloured by the root it converges to (see colour_roots()).  The
+/// polynomial is kept as its roots, and multiplied out into coefficients
+/// once per frame, before the workers start (see expand_roots()).
+///
+///   - W, A, S, D pan, Q and E zoom, [ and ] change the step limit, and H goes
+///     back to the home view, as in Mandelbrot.
+///   - 2 to 8 start over with the roots of z^n - 1.
+///   - Drag a root with the left mouse button to move it.
+class Newton : public TextureRenderer
+{
+  View<double> view;           /// Step limit, zoom and centre of the renderer
+  Polynomial<double> poly;     /// Roots and coefficients, for the current frame
+  Precision precision;         /// Float or double, whichever resolves the view
+  View<float> view_float;      /// view and poly rounded to float; see update_view()
+  Polynomial<float> poly_float;
+  const KernelSet * kernels;   /// Kernels for the instruction set picked at startup
+  int * counts;                /// Raw kernel output for the frame, one entry per pixel
+  int * roots;                 /// in row order; coloured into data by colour_roots()
+  int grabbed;                 /// Root being dragged with the mouse, or -1
+
+public:
+  /// Renders with the given kernels, which must be supported by this machine
+  /// (see cpu_detect() and kernels_for()).  Starts with the roots of z^3 - 1.
+  Newton(int width, int height, const KernelSet & kernels);
+  virtual ~Newton();
+
+private:
+  /// Computes and colours the frame, one task per row.
+  void compute_frame();
+
+  /// Runs the kernel for the current precision on pixels [x1, x2) of row j.
+  void compute_row(int j, int x1, int x2, int * counts, int * roots);
+
+  /// Places the roots of z^degree - 1.
+  void roots_of_unity(int degree);
+
+  /// Picks the precision for the current view, and rounds the view and the
+  /// polynomial to it.  Only called between frames.
+  void update_view();
+
+protected:
+  void handle_inputs();
+  void place_buffers();
+
+  /// Whether a key that pans, zooms, changes the limit or picks another
+  /// degree is down, or a root is being dragged.
+  bool view_input();
+};
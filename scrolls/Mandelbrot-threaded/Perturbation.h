@@ -0,0 +1,199 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Deep zoom by perturbation.  Past double precision, iterating every pixel in
+/// a wide number type is far too slow.  Instead, one reference orbit is
+/// computed per frame in a wide type at the centre of the view, and each
+/// pixel only iterates its (tiny) difference from that orbit in double, with
+/// the SIMD delta kernels.
+///
+/// The view is kept in 1024-bit fixed point, and the reference orbit is
+/// computed in the cheapest type that resolves it: double-double, or 128-,
+/// 256- or 1024-bit fixed point (BigFixed.h).
+///
+/// With the series approximation (Series.h) on, pixels also start iterating
+/// where the series leaves off rather than at 0.
+///
+/// Where the difference stops being accurate the kernel flags a glitch.  The
+/// glitched pixels of each region are then re-rendered against a new
+/// reference taken from among themselves, until none are left.
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "Kernels.h"
+#include "BigFixed.h"
+#include "Series.h"
+
+/// Most extra references a single call to render() will take.
+static const int MAX_REFERENCES = 16;
+
+/// One step of z = z^2 + c, for number types without a faster one of their own.
+template <class R>
+static inline void mandelbrot_step(R & x, R & y, const R & cr, const R & ci)
+{
+  R xx = x * x;
+  R yy = y * y;
+  R xy = x * y;
+  x = xx - yy + cr;
+  y = xy + xy + ci;
+}
+
+template <class R>
+static inline double to_double(const R & a)
+{
+  return (double)a;
+}
+
+/// Iterates Z_{n+1} = Z_n^2 + C in R from Z_0 = 0, storing Z_0 up to the
+/// point where it escapes (inclusive) or limit, rounded to double.  R needs
+/// +, -, *, construction from double, and to_double().
+template <class R>
+void reference_orbit(const R & cr, const R & ci, int limit,
+                     std::vector<double> & zr, std::vector<double> & zi)
+{
+  zr.clear();
+  zi.clear();
+  R x = 0.0, y = 0.0;
+  for (int i = 0; i < limit; ++i) {
+    double dx = to_double(x);
+    double dy = to_double(y);
+    zr.push_back(dx);
+    zi.push_back(dy);
+    if (dx*dx + dy*dy >= 4)
+      break;
+    mandelbrot_step(x, y, cr, ci);
+  }
+}
+
+class Perturbation
+{
+  View<Fixed1024> view;           /// View being rendered, in full precision
+  Precision reference;            /// Number type reference orbits are computed in
+  std::vector<double> zr, zi;     /// Reference orbit at the centre of the view
+  Series series;                  /// Iterations every pixel can skip
+  const KernelSet * kernels;
+
+public:
+  Perturbation() : reference(PRECISION_DOUBLE_DOUBLE), kernels(NULL) {}
+
+  /// Computes the reference orbit, in the given precision or double-double if
+  /// that is wider, and the series if use_series is set, for a new frame.
+  /// Call this between frames, never while render() is running.
+  void prepare(const View<Fixed1024> & view, Precision reference,
+               const KernelSet * kernels, bool use_series) {
+    this->view = view;
+    this->reference = reference > PRECISION_DOUBLE_DOUBLE ? reference : PRECISION_DOUBLE_DOUBLE;
+    this->kernels = kernels;
+    orbit_at(view.cx, view.cy, zr, zi);
+    series = Series();
+    if (use_series) {
+      Orbit orbit = { &zr[0], &zi[0], (int)zr.size() };
+      double scale = to_double(view.scale);
+      series = series_for(orbit, view.limit, scale / 2, scale / 2);
+    }
+  }
+
+  /// Number type the reference orbits of this frame are computed in.
+  Precision reference_precision() const { return reference; }
+
+  /// Iterations the series lets every pixel skip this frame.
+  int skipped() const { return series.skip; }
+
+  /// Fills counts and norms, row by row, with the escape counts and |Z|^2 of
+  /// pixels [x1, x2) x [y1, y2), as for RowKernel.  Safe to call from several
+  /// threads at once.
+  void render(int x1, int y1, int x2, int y2, int * counts, float * norms) const {
+    int w = x2 - x1;
+    int n = w * (y2 - y1);
+    double dx = to_double(view.scale) / view.width;
+    double dy = to_double(view.scale) / view.height;
+    std::vector<double> dcr(n), dci(n);
+    for (int j = y1; j < y2; ++j) {
+      for (int i = x1; i < x2; ++i) {
+        dcr[(j - y1) * w + i - x1] = (i - view.width / 2) * dx;
+        dci[(j - y1) * w + i - x1] = (j - view.height / 2) * dy;
+      }
+    }
+    Orbit orbit = { &zr[0], &zi[0], (int)zr.size() };
+    if (series.skip > 0) {
+      std::vector<double> d0r(n), d0i(n);
+      for (int k = 0; k < n; ++k) {
+        std::complex<double> d = series.evaluate(dcr[k], dci[k]);
+        d0r[k] = d.real();
+        d0i[k] = d.imag();
+      }
+      kernels->delta(orbit, view.limit, series.skip, &dcr[0], &dci[0], &d0r[0], &d0i[0], n, counts, norms);
+    } else {
+      kernels->delta(orbit, view.limit, 0, &dcr[0], &dci[0], NULL, NULL, n, counts, norms);
+    }
+
+    std::vector<int> glitched;
+    for (int k = 0; k < n; ++k)
+      if (counts[k] == GLITCHED)
+        glitched.push_back(k);
+
+    /// Re-reference: a pixel from the middle of the glitched ones becomes the
+    /// new reference, and every glitched pixel is redone relative to it.
+    std::vector<double> rr, ri, gr, gi;
+    std::vector<int> result;
+    std::vector<float> result_norms;
+    for (int r = 0; r < MAX_REFERENCES && !glitched.empty(); ++r) {
+      int ref = glitched[glitched.size() / 2];
+      orbit_at(view.cx + Fixed1024(dcr[ref]), view.cy + Fixed1024(dci[ref]), rr, ri);
+      Orbit second = { &rr[0], &ri[0], (int)rr.size() };
+      int m = (int)glitched.size();
+      gr.resize(m);
+      gi.resize(m);
+      result.resize(m);
+      result_norms.resize(m);
+      for (int k = 0; k < m; ++k) {
+        gr[k] = dcr[glitched[k]] - dcr[ref];
+        gi[k] = dci[glitched[k]] - dci[ref];
+      }
+      kernels->delta(second, view.limit, 0, &gr[0], &gi[0], NULL, NULL, m, &result[0], &result_norms[0]);
+
+      int left = 0;
+      for (int k = 0; k < m; ++k) {
+        counts[glitched[k]] = result[k];
+        norms[glitched[k]] = result_norms[k];
+        if (result[k] == GLITCHED)
+          glitched[left++] = glitched[k];
+      }
+      glitched.resize(left);
+    }
+    /// Out of references; treat whatever is left as interior.
+    for (size_t k = 0; k < glitched.size(); ++k) {
+      counts[glitched[k]] = view.limit;
+      norms[glitched[k]] = 0;
+    }
+  }
+
+private:
+  /// Reference orbit at C = (cr, ci), in the reference precision.
+  void orbit_at(const Fixed1024 & cr, const Fixed1024 & ci,
+                std::vector<double> & zr, std::vector<double> & zi) const {
+    switch (reference) {
+    case PRECISION_FIXED_128:
+      orbit_in<Fixed128>(cr, ci, zr, zi);
+      break;
+    case PRECISION_FIXED_256:
+      orbit_in<Fixed256>(cr, ci, zr, zi);
+      break;
+    case PRECISION_FIXED_1024:
+      reference_orbit(cr, ci, view.limit, zr, zi);
+      break;
+    default:
+      orbit_in<DoubleDouble>(cr, ci, zr, zi);
+      break;
+    }
+  }
+
+  template <class R>
+  void orbit_in(const Fixed1024 & cr, const Fixed1024 & ci,
+                std::vector<double> & zr, std::vector<double> & zi) const {
+    R r, i;
+    convert(cr, r);
+    convert(ci, i);
+    reference_orbit(r, i, view.limit, zr, zi);
+  }
+};
@@ -0,0 +1,102 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <cmath>
+#include "Series.h"
+using namespace std;
+
+typedef complex<double> Complex;
+
+/// Advances the coefficients in a by one iteration along Z.
+static void series_step(Complex * a, Complex z, double radius)
+{
+  Complex next[SERIES_TERMS];
+  Complex z2 = 2.0 * z;
+  next[0] = z2 * a[0] + radius;
+  for (int k = 1; k < SERIES_TERMS; ++k) {
+    Complex sum = 0;
+    for (int i = 0; i < k; ++i)
+      sum += a[i] * a[k - 1 - i];
+    next[k] = z2 * a[k] + sum;
+  }
+  for (int k = 0; k < SERIES_TERMS; ++k)
+    a[k] = next[k];
+}
+
+/// Coefficients of the series after skip iterations.
+static void series_at(const Orbit & orbit, int skip, Series & series)
+{
+  for (int k = 0; k < SERIES_TERMS; ++k)
+    series.a[k] = 0;
+  for (int n = 0; n < skip; ++n)
+    series_step(series.a, Complex(orbit.zr[n], orbit.zi[n]), series.radius);
+  series.skip = skip;
+}
+
+/// Iterates the perturbation of one probe pixel the long way.  Returns the
+/// iteration it escaped or glitched at, or skip if it got there intact, with
+/// d_skip in d.
+static int probe(const Orbit & orbit, int skip, Complex dc, Complex & d)
+{
+  d = 0;
+  for (int n = 0; n < skip; ++n) {
+    Complex z = Complex(orbit.zr[n], orbit.zi[n]);
+    double r2 = norm(z + d);
+    if (r2 >= 4 || r2 < GLITCH_TOLERANCE * norm(z))
+      return n;
+    d = 2.0 * z * d + d * d + dc;
+  }
+  return skip;
+}
+
+Series series_for(const Orbit & orbit, int limit, double half_width, double half_height)
+{
+  Series series;
+  series.radius = sqrt(half_width * half_width + half_height * half_height);
+
+  /// Kernels read Z_skip, so the series may go at most to the last point of
+  /// the orbit, and no further than the limit.
+  int last = (limit < orbit.length ? limit : orbit.length) - 1;
+  int skip = 0;
+  Complex a[SERIES_TERMS];
+  for (; skip < last; ++skip) {
+    Complex next[SERIES_TERMS];
+    for (int k = 0; k < SERIES_TERMS; ++k)
+      next[k] = a[k];
+    series_step(next, Complex(orbit.zr[skip], orbit.zi[skip]), series.radius);
+    if (abs(next[SERIES_TERMS - 1]) > SERIES_TOLERANCE * abs(next[0]))
+      break;
+    for (int k = 0; k < SERIES_TERMS; ++k)
+      a[k] = next[k];
+  }
+
+  /// Corners and edge midpoints are as far from the reference as pixels get.
+  const int probes = 8;
+  Complex dc[probes] = {
+    Complex(-half_width, -half_height), Complex(0, -half_height),
+    Complex(half_width, -half_height), Complex(half_width, 0),
+    Complex(half_width, half_height), Complex(0, half_height),
+    Complex(-half_width, half_height), Complex(-half_width, 0)
+  };
+  while (skip > 0) {
+    for (int p = 0; p < probes; ++p) {
+      Complex d;
+      int reached = probe(orbit, skip, dc[p], d);
+      if (reached < skip)
+        skip = reached;
+    }
+    if (skip == 0)
+      break;
+    series_at(orbit, skip, series);
+    bool agree = true;
+    for (int p = 0; p < probes && agree; ++p) {
+      Complex d;
+      probe(orbit, skip, dc[p], d);
+      Complex e = series.evaluate(dc[p].real(), dc[p].imag());
+      agree = abs(e - d) <= PROBE_TOLERANCE * abs(d);
+    }
+    if (agree)
+      return series;
+    skip = skip * 3 / 4;
+  }
+  series.skip = 0;
+  return series;
+}
@@ -0,0 +1,57 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Series approximation for perturbation renders.  Deep in a zoom every pixel
+/// follows nearly the same path for thousands of iterations, so instead of
+/// iterating d_n for each of them, d_n is written as a polynomial in dc
+///
+///   d_n = a_1 u + a_2 u^2 + ... + a_K u^K,    u = dc / radius
+///
+/// whose coefficients follow from d_{n+1} = 2 Z_n d_n + d_n^2 + dc:
+///
+///   a_1' = 2 Z_n a_1 + radius
+///   a_k' = 2 Z_n a_k + sum_{i+j=k} a_i a_j
+///
+/// The coefficients are iterated once per frame along the reference orbit,
+/// and every pixel starts at iteration skip from the polynomial instead of 0.
+/// Scaling dc by the radius of the frame keeps |u| <= 1 and the coefficients
+/// within the range of a double, however deep the zoom.
+#pragma once
+#include <complex>
+#include "Kernels.h"
+
+/// Number of terms kept in the series.
+static const int SERIES_TERMS = 8;
+
+/// The series stops at the first iteration where its last term is no longer
+/// this small against the first.  With |u| <= 1, that bounds the relative
+/// truncation error of every pixel in the frame.
+static const double SERIES_TOLERANCE = 1e-12;
+
+/// Largest relative difference allowed between the series and a probe pixel
+/// iterated the long way.  If any probe is further off, skip is reduced.
+static const double PROBE_TOLERANCE = 1e-8;
+
+struct Series {
+  int skip;                       /// Iterations the series replaces; 0 for none
+  double radius;                  /// Largest |dc| in the frame
+  std::complex<double> a[SERIES_TERMS];
+
+  Series() : skip(0), radius(1) {}
+
+  /// d_skip for a pixel at dc from the reference.
+  std::complex<double> evaluate(double dcr, double dci) const {
+    std::complex<double> u = std::complex<double>(dcr, dci) / radius;
+    std::complex<double> d = a[SERIES_TERMS - 1];
+    for (int k = SERIES_TERMS - 2; k >= 0; --k)
+      d = d * u + a[k];
+    return d * u;
+  }
+};
+
+/// Builds the longest series along orbit that is accurate for every pixel of
+/// a frame reaching half_width and half_height either side of the reference.
+/// The truncation test picks a candidate skip, which is then checked against
+/// probe pixels on the edge of the frame iterated the long way, and reduced
+/// until they all agree.
+Series series_for(const Orbit & orbit, int limit, double half_width, double half_height);
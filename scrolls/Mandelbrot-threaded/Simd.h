@@ -0,0 +1,380 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Thin wrappers around the SIMD instruction sets, so one kernel template can
+/// be written once and compiled for each of them.  Every wrapper provides:
+///
+///   T        scalar number type        width       number of lanes
+///   V        vector of T               fused       whether fmadd is a true FMA
+///   Mask     result of a comparison    Count       vector of counters
+///
+///   set1(a), index()                   broadcast a; the lanes 0, 1, 2, ...
+///   add, sub, mul, div                 element-wise arithmetic
+///   fmadd(a, b, c), fmsub(a, b, c)     a*b + c and a*b - c
+///   abs(a)                             |a|, element-wise
+///   load(p)                            width values from p, unaligned
+///   lt(a, b), any(m), bits(m)          comparison; whether any lane is set; lanes as bits
+///   mask_all(), mask_none()            masks with every lane set or clear
+///   mask_and, mask_or, mask_andnot     a & b, a | b and a & ~b
+///   select(m, a, b)                    lanes of a where m is set, of b elsewhere
+///   count_zero(), count_inc(n, m)      counters, adding one to the lanes in m
+///   store(n, out)                      writes width ints to out
+///   store_float(v, out)                writes width values to out, rounded to float
+///
+/// DoubleDoubleSimd builds double-double vectors on top of a double wrapper.
+/// It has everything but load() and div().
+///
+/// Only the wrappers the current translation unit was compiled for are
+/// defined, so include this from the Kernels*.cpp files only.
+#pragma once
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define SIMD_SSE2
+#endif
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  #define SIMD_AVX2
+#endif
+#if defined(__AVX512F__)
+  #include <immintrin.h>
+  #define SIMD_AVX512
+#endif
+
+/// MSVC does not define __FMA__, but every AVX2 part it targets has FMA.
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+  #define SIMD_FMA
+#endif
+
+#ifdef SIMD_SSE2
+/// 4 floats.  SSE2 has no FMA, so the results match the scalar kernel exactly.
+struct FloatSSE2 {
+  typedef float T;
+  typedef __m128 V;
+  typedef __m128 Mask;
+  typedef __m128i Count;
+  enum { width = 4, fused = 0 };
+
+  static V set1(T a) { return _mm_set1_ps(a); }
+  static V index() { return _mm_setr_ps(0, 1, 2, 3); }
+  static V load(const T * p) { return _mm_loadu_ps(p); }
+  static V add(V a, V b) { return _mm_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm_div_ps(a, b); }
+  static V fmadd(V a, V b, V c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static V fmsub(V a, V b, V c) { return _mm_sub_ps(_mm_mul_ps(a, b), c); }
+  static V abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+  static Mask lt(V a, V b) { return _mm_cmplt_ps(a, b); }
+  static bool any(Mask m) { return _mm_movemask_ps(m) != 0; }
+  static int bits(Mask m) { return _mm_movemask_ps(m); }
+  static Mask mask_all() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+  static Mask mask_none() { return _mm_setzero_ps(); }
+  static Mask mask_and(Mask a, Mask b) { return _mm_and_ps(a, b); }
+  static Mask mask_or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+  static Mask mask_andnot(Mask a, Mask b) { return _mm_andnot_ps(b, a); }
+  static V select(Mask m, V a, V b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+  static Count count_zero() { return _mm_setzero_si128(); }
+  /// A set lane is all ones, i.e. -1, so subtracting the mask counts it.
+  static Count count_inc(Count n, Mask m) { return _mm_sub_epi32(n, _mm_castps_si128(m)); }
+  static void store(Count n, int * out) { _mm_storeu_si128((__m128i *)out, n); }
+  static void store_float(V v, float * out) { _mm_storeu_ps(out, v); }
+};
+
+/// 2 doubles.  Counters are kept as doubles, which saves shuffling the 64-bit
+/// comparison masks down to 32-bit ints on every iteration.
+struct DoubleSSE2 {
+  typedef double T;
+  typedef __m128d V;
+  typedef __m128d Mask;
+  typedef __m128d Count;
+  enum { width = 2, fused = 0 };
+
+  static V set1(T a) { return _mm_set1_pd(a); }
+  static V index() { return _mm_setr_pd(0, 1); }
+  static V load(const T * p) { return _mm_loadu_pd(p); }
+  static V add(V a, V b) { return _mm_add_pd(a, b); }
+  static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+  static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+  static V div(V a, V b) { return _mm_div_pd(a, b); }
+  static V fmadd(V a, V b, V c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+  static V fmsub(V a, V b, V c) { return _mm_sub_pd(_mm_mul_pd(a, b), c); }
+  static V abs(V a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+  static Mask lt(V a, V b) { return _mm_cmplt_pd(a, b); }
+  static bool any(Mask m) { return _mm_movemask_pd(m) != 0; }
+  static int bits(Mask m) { return _mm_movemask_pd(m); }
+  static Mask mask_all() { return _mm_castsi128_pd(_mm_set1_epi32(-1)); }
+  static Mask mask_none() { return _mm_setzero_pd(); }
+  static Mask mask_and(Mask a, Mask b) { return _mm_and_pd(a, b); }
+  static Mask mask_or(Mask a, Mask b) { return _mm_or_pd(a, b); }
+  static Mask mask_andnot(Mask a, Mask b) { return _mm_andnot_pd(b, a); }
+  static V select(Mask m, V a, V b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+  static Count count_zero() { return _mm_setzero_pd(); }
+  static Count count_inc(Count n, Mask m) { return _mm_add_pd(n, _mm_and_pd(m, _mm_set1_pd(1.0))); }
+  static void store(Count n, int * out) { _mm_storel_epi64((__m128i *)out, _mm_cvttpd_epi32(n)); }
+  static void store_float(V v, float * out) { _mm_storel_pi((__m64 *)out, _mm_cvtpd_ps(v)); }
+};
+#endif
+
+#ifdef SIMD_AVX2
+/// 8 floats, with FMA where the compiler allows it.
+struct FloatAVX2 {
+  typedef float T;
+  typedef __m256 V;
+  typedef __m256 Mask;
+  typedef __m256i Count;
+#ifdef SIMD_FMA
+  enum { width = 8, fused = 1 };
+#else
+  enum { width = 8, fused = 0 };
+#endif
+
+  static V set1(T a) { return _mm256_set1_ps(a); }
+  static V index() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+  static V load(const T * p) { return _mm256_loadu_ps(p); }
+  static V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm256_div_ps(a, b); }
+#ifdef SIMD_FMA
+  static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+  static V fmsub(V a, V b, V c) { return _mm256_fmsub_ps(a, b, c); }
+#else
+  static V fmadd(V a, V b, V c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+  static V fmsub(V a, V b, V c) { return _mm256_sub_ps(_mm256_mul_ps(a, b), c); }
+#endif
+  static V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+  static Mask lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static bool any(Mask m) { return _mm256_movemask_ps(m) != 0; }
+  static int bits(Mask m) { return _mm256_movemask_ps(m); }
+  static Mask mask_all() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+  static Mask mask_none() { return _mm256_setzero_ps(); }
+  static Mask mask_and(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+  static Mask mask_or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+  static Mask mask_andnot(Mask a, Mask b) { return _mm256_andnot_ps(b, a); }
+  static V select(Mask m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+  static Count count_zero() { return _mm256_setzero_si256(); }
+  static Count count_inc(Count n, Mask m) { return _mm256_sub_epi32(n, _mm256_castps_si256(m)); }
+  static void store(Count n, int * out) { _mm256_storeu_si256((__m256i *)out, n); }
+  static void store_float(V v, float * out) { _mm256_storeu_ps(out, v); }
+};
+
+/// 4 doubles, with FMA where the compiler allows it.
+struct DoubleAVX2 {
+  typedef double T;
+  typedef __m256d V;
+  typedef __m256d Mask;
+  typedef __m256d Count;
+#ifdef SIMD_FMA
+  enum { width = 4, fused = 1 };
+#else
+  enum { width = 4, fused = 0 };
+#endif
+
+  static V set1(T a) { return _mm256_set1_pd(a); }
+  static V index() { return _mm256_setr_pd(0, 1, 2, 3); }
+  static V load(const T * p) { return _mm256_loadu_pd(p); }
+  static V add(V a, V b) { return _mm256_add_pd(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+  static V div(V a, V b) { return _mm256_div_pd(a, b); }
+#ifdef SIMD_FMA
+  static V fmadd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+  static V fmsub(V a, V b, V c) { return _mm256_fmsub_pd(a, b, c); }
+#else
+  static V fmadd(V a, V b, V c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+  static V fmsub(V a, V b, V c) { return _mm256_sub_pd(_mm256_mul_pd(a, b), c); }
+#endif
+  static V abs(V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+  static Mask lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static bool any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+  static int bits(Mask m) { return _mm256_movemask_pd(m); }
+  static Mask mask_all() { return _mm256_castsi256_pd(_mm256_set1_epi32(-1)); }
+  static Mask mask_none() { return _mm256_setzero_pd(); }
+  static Mask mask_and(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+  static Mask mask_or(Mask a, Mask b) { return _mm256_or_pd(a, b); }
+  static Mask mask_andnot(Mask a, Mask b) { return _mm256_andnot_pd(b, a); }
+  static V select(Mask m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+  static Count count_zero() { return _mm256_setzero_pd(); }
+  static Count count_inc(Count n, Mask m) {
+    return _mm256_add_pd(n, _mm256_and_pd(m, _mm256_set1_pd(1.0)));
+  }
+  static void store(Count n, int * out) { _mm_storeu_si128((__m128i *)out, _mm256_cvttpd_epi32(n)); }
+  static void store_float(V v, float * out) { _mm_storeu_ps(out, _mm256_cvtpd_ps(v)); }
+};
+#endif
+
+#ifdef SIMD_AVX512
+/// 16 floats.  Comparisons give a bit mask rather than a vector.
+struct FloatAVX512 {
+  typedef float T;
+  typedef __m512 V;
+  typedef __mmask16 Mask;
+  typedef __m512i Count;
+  enum { width = 16, fused = 1 };
+
+  static V set1(T a) { return _mm512_set1_ps(a); }
+  static V index() {
+    return _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  }
+  static V load(const T * p) { return _mm512_loadu_ps(p); }
+  static V add(V a, V b) { return _mm512_add_ps(a, b); }
+  static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+  static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+  static V div(V a, V b) { return _mm512_div_ps(a, b); }
+  static V fmadd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+  static V fmsub(V a, V b, V c) { return _mm512_fmsub_ps(a, b, c); }
+  static V abs(V a) { return _mm512_abs_ps(a); }
+  static Mask lt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+  static bool any(Mask m) { return m != 0; }
+  static int bits(Mask m) { return m; }
+  static Mask mask_all() { return (Mask)0xffff; }
+  static Mask mask_none() { return (Mask)0; }
+  static Mask mask_and(Mask a, Mask b) { return (Mask)(a & b); }
+  static Mask mask_or(Mask a, Mask b) { return (Mask)(a | b); }
+  static Mask mask_andnot(Mask a, Mask b) { return (Mask)(a & ~b); }
+  static V select(Mask m, V a, V b) { return _mm512_mask_blend_ps(m, b, a); }
+  static Count count_zero() { return _mm512_setzero_si512(); }
+  static Count count_inc(Count n, Mask m) {
+    return _mm512_mask_add_epi32(n, m, n, _mm512_set1_epi32(1));
+  }
+  static void store(Count n, int * out) { _mm512_storeu_si512((void *)out, n); }
+  static void store_float(V v, float * out) { _mm512_storeu_ps(out, v); }
+};
+
+/// 8 doubles.
+struct DoubleAVX512 {
+  typedef double T;
+  typedef __m512d V;
+  typedef __mmask8 Mask;
+  typedef __m512i Count;
+  enum { width = 8, fused = 1 };
+
+  static V set1(T a) { return _mm512_set1_pd(a); }
+  static V index() { return _mm512_setr_pd(0, 1, 2, 3, 4, 5, 6, 7); }
+  static V load(const T * p) { return _mm512_loadu_pd(p); }
+  static V add(V a, V b) { return _mm512_add_pd(a, b); }
+  static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+  static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+  static V div(V a, V b) { return _mm512_div_pd(a, b); }
+  static V fmadd(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+  static V fmsub(V a, V b, V c) { return _mm512_fmsub_pd(a, b, c); }
+  static V abs(V a) { return _mm512_abs_pd(a); }
+  static Mask lt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+  static bool any(Mask m) { return m != 0; }
+  static int bits(Mask m) { return m; }
+  static Mask mask_all() { return (Mask)0xff; }
+  static Mask mask_none() { return (Mask)0; }
+  static Mask mask_and(Mask a, Mask b) { return (Mask)(a & b); }
+  static Mask mask_or(Mask a, Mask b) { return (Mask)(a | b); }
+  static Mask mask_andnot(Mask a, Mask b) { return (Mask)(a & ~b); }
+  static V select(Mask m, V a, V b) { return _mm512_mask_blend_pd(m, b, a); }
+  static Count count_zero() { return _mm512_setzero_si512(); }
+  static Count count_inc(Count n, Mask m) {
+    return _mm512_mask_add_epi64(n, m, n, _mm512_set1_epi64(1));
+  }
+  static void store(Count n, int * out) {
+    _mm256_storeu_si256((__m256i *)out, _mm512_maskz_cvtepi64_epi32(0xff, n));
+  }
+  static void store_float(V v, float * out) { _mm256_storeu_ps(out, _mm512_maskz_cvtpd_ps(0xff, v)); }
+};
+#endif
+
+#if defined(SIMD_SSE2) || defined(SIMD_AVX2) || defined(SIMD_AVX512)
+#include "DoubleDouble.h"
+
+/// Double-double vectors, built from a double wrapper S with the same
+/// algorithms as DoubleDouble.h.  Where S has a true FMA, the exact product
+/// takes two instructions instead of Dekker's split.
+template <class S>
+struct DoubleDoubleSimd {
+  typedef DoubleDouble T;
+  typedef typename S::V D;
+  struct V {
+    D hi;
+    D lo;
+  };
+  typedef typename S::Mask Mask;
+  typedef typename S::Count Count;
+  enum { width = S::width, fused = 0 };
+
+  static V make(D hi, D lo) { V v; v.hi = hi; v.lo = lo; return v; }
+  static V set1(const T & a) { return make(S::set1(a.hi), S::set1(a.lo)); }
+  static V index() { return make(S::index(), S::set1(0.0)); }
+
+  static D two_sum(D a, D b, D & e) {
+    D s = S::add(a, b);
+    D bb = S::sub(s, a);
+    e = S::add(S::sub(a, S::sub(s, bb)), S::sub(b, bb));
+    return s;
+  }
+
+  static D quick_two_sum(D a, D b, D & e) {
+    D s = S::add(a, b);
+    e = S::sub(b, S::sub(s, a));
+    return s;
+  }
+
+  static D two_prod(D a, D b, D & e) {
+    D p = S::mul(a, b);
+    if (S::fused) {
+      e = S::fmsub(a, b, p);
+      return p;
+    }
+    const D split = S::set1(134217729.0);
+    D t = S::mul(split, a);
+    D ah = S::sub(t, S::sub(t, a));
+    D al = S::sub(a, ah);
+    t = S::mul(split, b);
+    D bh = S::sub(t, S::sub(t, b));
+    D bl = S::sub(b, bh);
+    e = S::add(S::add(S::add(S::sub(S::mul(ah, bh), p), S::mul(ah, bl)), S::mul(al, bh)),
+               S::mul(al, bl));
+    return p;
+  }
+
+  static V add(V a, V b) {
+    D e;
+    D s = two_sum(a.hi, b.hi, e);
+    e = S::add(e, S::add(a.lo, b.lo));
+    s = quick_two_sum(s, e, e);
+    return make(s, e);
+  }
+
+  static V sub(V a, V b) {
+    const D zero = S::set1(0.0);
+    return add(a, make(S::sub(zero, b.hi), S::sub(zero, b.lo)));
+  }
+
+  static V mul(V a, V b) {
+    D e;
+    D p = two_prod(a.hi, b.hi, e);
+    e = S::add(e, S::add(S::mul(a.hi, b.lo), S::mul(a.lo, b.hi)));
+    p = quick_two_sum(p, e, e);
+    return make(p, e);
+  }
+
+  static V fmadd(V a, V b, V c) { return add(mul(a, b), c); }
+  static V fmsub(V a, V b, V c) { return sub(mul(a, b), c); }
+  /// The sign of a double-double is the sign of its high part.
+  static V abs(V a) {
+    const D zero = S::set1(0.0);
+    Mask m = S::lt(a.hi, zero);
+    return make(S::select(m, S::sub(zero, a.hi), a.hi), S::select(m, S::sub(zero, a.lo), a.lo));
+  }
+
+  /// Only the high parts are compared, which is plenty for a bailout test.
+  static Mask lt(V a, V b) { return S::lt(a.hi, b.hi); }
+  static bool any(Mask m) { return S::any(m); }
+  static int bits(Mask m) { return S::bits(m); }
+  static Mask mask_all() { return S::mask_all(); }
+  static Mask mask_none() { return S::mask_none(); }
+  static Mask mask_and(Mask a, Mask b) { return S::mask_and(a, b); }
+  static Mask mask_or(Mask a, Mask b) { return S::mask_or(a, b); }
+  static Mask mask_andnot(Mask a, Mask b) { return S::mask_andnot(a, b); }
+  static V select(Mask m, V a, V b) { return make(S::select(m, a.hi, b.hi), S::select(m, a.lo, b.lo)); }
+  static Count count_zero() { return S::count_zero(); }
+  static Count count_inc(Count n, Mask m) { return S::count_inc(n, m); }
+  static void store(Count n, int * out) { S::store(n, out); }
+  static void store_float(V v, float * out) { S::store_float(v.hi, out); }
+};
+#endif
@@ -1,22 +1,24 @@
 /// Author: Xavier Ho (contact@xavierho.com)
-#include <cstring>
 #include <iostream>
 #include "TextureRenderer.h"
+#include "WorkerTuner.h"
 using namespace std;
 
 struct BBox;
 
 TextureRenderer::TextureRenderer(int width, int height)
-  : Threading(), timer()
+  : timer()
 {
   this->texture_id = 0;
-  this->resources = 0;
   this->width = width;
   this->height = height;
-  pthread_mutex_init(&count_mutex, NULL);
-  pthread_cond_init(&count_threshold_cv, NULL);
+  this->pool = NULL;
+  this->view_changed = true;
+  this->finished = true;
+  this->generation = 0;
+  this->frame_generation = 0;
+  this->input_at_start = false;
   this->data = new unsigned char[width * height * 3];
-  memset(this->data, 0, width * height * 3 * sizeof(unsigned char));
   glfwInit();
 }
 
@@ -24,30 +26,49 @@ TextureRenderer::~TextureRenderer()
 {
   if (data != NULL)
     delete[] data;
-  pthread_mutex_destroy(&count_mutex);
-  pthread_cond_destroy(&count_threshold_cv);
   glfwTerminate();
 }
 
-void TextureRenderer::start_threaded(int count)
+void TextureRenderer::start_threaded(int count, bool tune, bool pin)
 {
+  ThreadPool workers(count);
+  WorkerTuner tuner(tune ? count : 1);
+  pool = &workers;
+  cout << "Running on " << count << " workers" << endl;
+  if (pin)
+    cout << "Pinned " << workers.pin(cpu_topology()) << " of them to processors, on "
+         << workers.nodes() << (workers.nodes() == 1 ? " node" : " nodes") << endl;
+  /// Before the window takes the texture from data.
+  place_buffers();
   __start();
-  thread_count = count;
-  threads_start(count);
   while (running) {
+    bool same_view = !view_changed;
+    view_changed = false;
+    frame_generation = generation.load();
+    input_at_start = view_input();
+    last_poll = chrono::steady_clock::now();
     timer.start();
-    while (resources != thread_count) {
-    } // Do nothing while rendering
-    render();
-    resources = 0;
+    compute_timer.start();
+    compute_frame();
+    /// Rendering waits for the display, whatever the workers do.
+    double compute_time = compute_timer.getMilliseconds();
+    /// A cancelled frame is out of date and part done, so the last one stays
+    /// up until the next is ready.
+    finished = generation.load() == frame_generation;
+    if (finished)
+      render();
     
     elapsed_time = timer.getMilliseconds();
-    cout << elapsed_time << endl; 
+    if (finished)
+      cout << elapsed_time << endl; 
+    else
+      cout << "Cancelled after " << elapsed_time << " ms" << endl;
 
     handle_inputs();
-    pthread_cond_broadcast(&count_threshold_cv); // Release the children once more
+    if (tune)
+      workers.set_active(tuner.frame(compute_time, same_view && finished));
   }
-  threads_wait();
+  pool = NULL;
 }
 
 void TextureRenderer::__start()
@@ -116,6 +137,31 @@ void TextureRenderer::render()
   glfwPollEvents();
 }
 
+void TextureRenderer::place_buffers()
+{
+  pool->first_touch(data, width * height * 3);
+}
+
+bool TextureRenderer::cancelled()
+{
+  if (pool->current() == 0 && !input_at_start && generation.load() == frame_generation) {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (now - last_poll >= chrono::milliseconds(POLL_MS)) {
+      last_poll = now;
+      glfwPollEvents();
+      if (view_input())
+        generation.fetch_add(1);
+    }
+  }
+  return generation.load() != frame_generation;
+}
+
+// Override this method
+bool TextureRenderer::view_input()
+{
+  return false;
+}
+
 // Override this method
 void TextureRenderer::handle_inputs()
 {
@@ -123,11 +169,3 @@ void TextureRenderer::handle_inputs()
           || glfwGetKey(GLFW_KEY_ESC) == GLFW_PRESS)
     running = false;
 }
-
-void TextureRenderer::thread_signal_and_wait()
-{
-  pthread_mutex_lock(&count_mutex);
-  resources++;
-  pthread_cond_wait(&count_threshold_cv, &count_mutex);
-  pthread_mutex_unlock(&count_mutex);
-}
@@ -11,29 +11,39 @@
   #include <GL/glew.h>
   #include <GL/glfw.h>
 #endif
+#include <atomic>
+#include <chrono>
 #include "Timer.h"
-#include "Threading.h"
+#include "ThreadPool.h"
 
 /// Simple renderer that draws a fullscreen quad with a texture.
 ///
 /// Multithreading is supported.  Override this:
 ///
-///   void thread_action(int index)
+///   void compute_frame()
 ///
 /// In addition, if you want to have more than ESC to quit, override:
 ///
 ///   void handle_inputs() (optional)
 ///
-/// See Threading.h for more information.
-class TextureRenderer : public Threading
+/// and to have frames cancelled as soon as the view starts to change, rather
+/// than finished and shown out of date:
+///
+///   bool view_input() (optional)
+///
+/// See ThreadPool.h for more information.
+class TextureRenderer
 {
   unsigned int texture_id;  /// Internal texture id tracker
   Timer timer;               /// Performance tracker
+  Timer compute_timer;       /// Times compute_frame() alone, for the tuner
 
-  /// Thread synchronisation stuff. Messy, could use some refactoring
-  pthread_mutex_t count_mutex; 
-  pthread_cond_t count_threshold_cv;
-  volatile int resources;            /// Number of threads completed; for synchronisation
+  /// Goes up whenever a frame is cancelled.  A frame is current while it
+  /// still equals frame_generation, which is taken as the frame starts.
+  std::atomic<unsigned> generation;
+  unsigned frame_generation;
+  bool input_at_start;       /// view_input() as the frame started
+  std::chrono::steady_clock::time_point last_poll;
   
 protected:
   double elapsed_time;      /// Total time took to render one frame, in ms
@@ -43,6 +53,19 @@ protected:
   unsigned char * data;     /// Texture data
   int width, height;        /// Texture resolution
 
+  /// Workers to compute frames on, while start_threaded() runs.  The pool
+  /// lives across frames.
+  ThreadPool * pool;
+
+  /// Set by handle_inputs() when the next frame will cost differently from
+  /// the last, e.g. because the view moved, so that the tuner does not
+  /// compare frames of different views.  Cleared once the frame starts.
+  bool view_changed;
+
+  /// Whether the last frame was computed in full and shown, rather than
+  /// cancelled.  Set before handle_inputs() runs.
+  bool finished;
+
 public:
   TextureRenderer(int width, int height);
   virtual ~TextureRenderer();
@@ -50,8 +73,15 @@ public:
   void set_window_title(const char * text);
   void set_window_size(int width, int height);
 
-  /// Starts a multi-threaded program with additional count threads
-  void start_threaded(int count);
+  /// Starts a multi-threaded program on count workers, the calling thread
+  /// being one of them, and runs it until the window closes.  With tune, the
+  /// frames run on as many of them as compute fastest (see WorkerTuner.h).
+  /// With pin, each worker is pinned to a processor of cpu_topology().
+  void start_threaded(int count, bool tune = false, bool pin = false);
+
+  /// How often the main thread checks for input while it works on a frame,
+  /// in ms.
+  enum { POLL_MS = 2 };
 
 private:
   void __start();
@@ -59,9 +89,32 @@ private:
   void render();
 
 protected:
-  /// Override this method to handle user inputs.
+  /// Override this method to fill data with the next frame, on pool.  It runs
+  /// on the main thread, which works on the frame too while it waits, and
+  /// must return once the frame is done.
+  virtual void compute_frame() = 0;
+
+  /// Whether the current frame has been cancelled, for compute_frame() to
+  /// check between pieces of work, e.g. tiles; once it has, the rest of the
+  /// pieces may be skipped.  On the main thread, this is also where input is
+  /// checked during a frame.
+  bool cancelled();
+
+  /// Override this method to say whether the inputs, as they are now, would
+  /// have handle_inputs() change the view, e.g. a key that pans held down.
+  /// It is polled while a frame computes, as the workers read the view, so
+  /// it must only read.  A frame that starts with it false is cancelled as
+  /// soon as it turns true; one that starts with it true, as while a key
+  /// is held, is already of the view the input leads to, and runs to the
+  /// end.  By default there is no such input.
+  virtual bool view_input();
+
+  /// Override this method to handle user inputs.  Runs between frames, while
+  /// no tasks are running.
   virtual void handle_inputs();
 
-  /// Thread synchronisation.  Call in thread_action() to signal finish.
-  void thread_signal_and_wait();
+  /// Override this method to also place buffers of your own, with
+  /// pool->first_touch(), and call this one.  Runs once the pool has started
+  /// and before the first frame; data is only zeroed here.
+  virtual void place_buffers();
 };
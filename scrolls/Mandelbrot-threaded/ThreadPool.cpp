@@ -0,0 +1,190 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <cstring>
+#include <map>
+#include "ThreadPool.h"
+using namespace std;
+
+/// Pool and worker index of the calling thread; see ThreadPool::current().
+static thread_local const ThreadPool * current_pool = NULL;
+static thread_local int current_index = -1;
+
+ThreadPool::ThreadPool(int workers)
+  : queued(0), stopping(false), sleeping(0), active_workers(0), node_count(1)
+{
+  if (workers < 1)
+    workers = 1;
+  active_workers = workers;
+  worker_nodes.assign(workers, 0);
+  for (int i = 0; i < workers; ++i)
+    this->workers.push_back(new Worker);
+  current_pool = this;
+  current_index = 0;
+  for (int i = 1; i < workers; ++i)
+    threads.push_back(thread(&ThreadPool::work, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    lock_guard<mutex> lock(sleep_mutex);
+    stopping = true;
+    wake.notify_all();
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+  for (size_t i = 0; i < workers.size(); ++i)
+    delete workers[i];
+  if (current_pool == this) {
+    current_pool = NULL;
+    current_index = -1;
+  }
+}
+
+int ThreadPool::current() const
+{
+  return current_pool == this ? current_index : -1;
+}
+
+void ThreadPool::on_each(const function<void(int)> & f)
+{
+  int n = active();
+  atomic<int> arrived(0);
+  TaskGroup group;
+  for (int i = 0; i < n; ++i) {
+    run(group, [this, n, &arrived, &f]() {
+      /// Holding every task until all have started leaves no worker free to
+      /// take a second one, so each worker gets exactly one.
+      arrived.fetch_add(1);
+      while (arrived.load() < n)
+        this_thread::yield();
+      f(current());
+    });
+  }
+  wait(group);
+}
+
+int ThreadPool::pin(const vector<Processor> & processors)
+{
+  if (processors.empty())
+    return 0;
+  atomic<int> pinned(0);
+  on_each([&](int i) {
+    if (pin_thread(processors[i % processors.size()].id))
+      pinned.fetch_add(1);
+  });
+  /// Number the nodes in use densely, so they can index arrays.
+  map<int, int> dense;
+  for (int i = 0; i < size(); ++i) {
+    int node = processors[i % processors.size()].node;
+    if (dense.find(node) == dense.end()) {
+      int next = (int)dense.size();
+      dense[node] = next;
+    }
+    worker_nodes[i] = dense[node];
+  }
+  node_count = (int)dense.size();
+  return pinned.load();
+}
+
+void ThreadPool::first_touch(void * buffer, size_t bytes)
+{
+  unsigned char * p = (unsigned char *)buffer;
+  size_t n = active();
+  on_each([p, bytes, n](int i) {
+    size_t begin = bytes * i / n, end = bytes * (i + 1) / n;
+    memset(p + begin, 0, end - begin);
+  });
+}
+
+void ThreadPool::set_active(int count)
+{
+  count = count < 1 ? 1 : count > size() ? size() : count;
+  lock_guard<mutex> lock(sleep_mutex);
+  active_workers = count;
+  wake.notify_all();
+}
+
+void ThreadPool::run(TaskGroup & group, const function<void()> & f)
+{
+  int index = current();
+  Worker & worker = *workers[index < 0 ? 0 : index];
+  group.pending.fetch_add(1);
+  Task task = { f, &group };
+  {
+    lock_guard<mutex> lock(worker.mutex);
+    worker.tasks.push_back(task);
+  }
+  /// queued goes up before sleeping is read, and a worker counts itself in
+  /// sleeping before it reads queued, so one of the two always sees the other.
+  queued.fetch_add(1);
+  /// A wake-up that lands on an inactive worker would be lost on it.
+  if (sleeping.load() > 0) {
+    lock_guard<mutex> lock(sleep_mutex);
+    if (active_workers.load() < size())
+      wake.notify_all();
+    else
+      wake.notify_one();
+  }
+}
+
+void ThreadPool::wait(TaskGroup & group)
+{
+  int index = current();
+  Task task;
+  while (group.pending.load(memory_order_acquire) > 0) {
+    if (take(index < 0 ? 0 : index, task))
+      execute(task);
+    else
+      this_thread::yield();
+  }
+}
+
+void ThreadPool::work(int index)
+{
+  current_pool = this;
+  current_index = index;
+  Task task;
+  for (;;) {
+    if (index < active_workers.load() && take(index, task)) {
+      execute(task);
+      continue;
+    }
+    unique_lock<mutex> lock(sleep_mutex);
+    sleeping.fetch_add(1);
+    while (!stopping.load() && (queued.load() == 0 || index >= active_workers.load()))
+      wake.wait(lock);
+    sleeping.fetch_sub(1);
+    if (stopping.load() && queued.load() == 0)
+      return;
+  }
+}
+
+bool ThreadPool::take(int index, Task & task)
+{
+  if (queued.load() == 0)
+    return false;
+  int n = size();
+  for (int k = 0; k < n; ++k) {
+    Worker & worker = *workers[(index + k) % n];
+    lock_guard<mutex> lock(worker.mutex);
+    if (worker.tasks.empty())
+      continue;
+    if (k == 0) {
+      task = worker.tasks.back();
+      worker.tasks.pop_back();
+    } else {
+      task = worker.tasks.front();
+      worker.tasks.pop_front();
+    }
+    queued.fetch_sub(1);
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::execute(Task & task)
+{
+  task.run();
+  task.run = nullptr;
+  task.group->pending.fetch_sub(1, memory_order_release);
+}
@@ -0,0 +1,154 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// A work-stealing thread pool on C++11 threads, which the renderers hand
+/// their frames to (see TextureRenderer).
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Cpu.h"
+
+/// Tasks that can be waited on together.  Every task run in a group counts
+/// towards it until it has finished.
+struct TaskGroup {
+  std::atomic<int> pending;   /// Tasks of the group not yet finished
+
+  TaskGroup() : pending(0) {}
+};
+
+/// A fixed set of workers that live as long as the pool, each with a deque of
+/// tasks.  A worker runs the newest task from the back of its own deque, and
+/// when that is empty, steals the oldest from the front of another's: a task
+/// that splits its work in half and runs one half itself leaves the other,
+/// larger part to be stolen first (see parallel_for()).  Workers with nothing
+/// to run or steal sleep until a task is submitted.
+///
+/// The thread that creates the pool is worker 0.  It has no thread of its own
+/// in the pool, but runs tasks while it waits for them, so a pool of n workers
+/// keeps n threads busy and a pool of 1 runs everything on its owner.  Tasks
+/// may only be submitted from the owner or from within other tasks.
+///
+/// Fewer workers than the pool has can be set active, e.g. to find how many
+/// run a frame fastest (see WorkerTuner); the rest sleep until they are
+/// needed again.
+///
+/// Workers can be pinned to processors, in which case each knows its NUMA
+/// node.  The OS places a page on the node of the thread that first touches
+/// it, so first_touch() spreads a buffer over the nodes of the workers that
+/// will work on it, rather than leaving all of it on the main thread's.
+///
+///   ThreadPool pool(cpu_count());
+///   pool.parallel_for(0, rows, 1, [&](int j) { compute_row(j); });
+class ThreadPool
+{
+  /// A task and the group it counts towards.
+  struct Task {
+    std::function<void()> run;
+    TaskGroup * group;
+  };
+
+  /// One worker's deque, on cache lines of its own.
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    char padding[64];
+  };
+
+  std::vector<Worker *> workers;        /// Deques of the workers, 0 being the owner's
+  std::vector<std::thread> threads;     /// Threads of workers 1 on
+  std::atomic<int> queued;              /// Tasks in all of the deques together
+  std::atomic<bool> stopping;           /// Set when the pool is destroyed
+  std::mutex sleep_mutex;               /// Guards the sleep on wake
+  std::condition_variable wake;
+  std::atomic<int> sleeping;            /// Workers waiting on wake
+  std::atomic<int> active_workers;      /// Workers that may run tasks, from 0
+  std::vector<int> worker_nodes;        /// NUMA node of each worker, once pinned
+  int node_count;                       /// Nodes the workers are pinned to, or 1
+
+public:
+  /// Starts workers - 1 threads; the calling thread is worker 0.
+  explicit ThreadPool(int workers);
+
+  /// Waits for the queued tasks to finish and stops the threads.
+  ~ThreadPool();
+
+  /// Number of workers, counting the owner.
+  int size() const { return (int)workers.size(); }
+
+  /// Number of workers that run tasks, counting the owner.
+  int active() const { return active_workers.load(); }
+
+  /// Lets only workers [0, count) run tasks, with count clamped to
+  /// [1, size()].  Only call it while no tasks are queued.
+  void set_active(int count);
+
+  /// Index of the worker the calling thread is, or -1 if it is not one of
+  /// this pool's.
+  int current() const;
+
+  /// Calls f(index) once on every active worker, on that worker's own
+  /// thread, and returns once all have returned.  Call it from the owner,
+  /// while no other tasks run.
+  void on_each(const std::function<void(int)> & f);
+
+  /// Pins worker i to processors[i], going round again if there are fewer
+  /// processors than workers, and keeps their nodes.  Workers that cannot be
+  /// pinned stay where the OS puts them.  Call it like on_each(), before any
+  /// set_active().  Returns the number of workers pinned.
+  int pin(const std::vector<Processor> & processors);
+
+  /// Zeroes a buffer that nothing has written to yet, worker i its i-th of
+  /// active() equal slices, so that each slice's pages land on its worker's
+  /// node.  Call it like on_each().
+  void first_touch(void * buffer, size_t bytes);
+
+  /// NUMA node of the given worker, counted from 0 over the nodes in use;
+  /// 0 until the pool is pinned.
+  int node(int worker) const { return worker_nodes[worker]; }
+
+  /// Number of NUMA nodes the workers are on, 1 until the pool is pinned.
+  int nodes() const { return node_count; }
+
+  /// Queues f to be run by any worker, as part of group.
+  void run(TaskGroup & group, const std::function<void()> & f);
+
+  /// Runs queued tasks, of any group, until every task of group has finished.
+  void wait(TaskGroup & group);
+
+  /// Calls f(i) for every i in [begin, end) and returns once all have
+  /// returned.  The range is split in halves, one queued and the other split
+  /// again, down to runs of at most grain indices, which one worker calls in
+  /// order.
+  template <class F>
+  void parallel_for(int begin, int end, int grain, const F & f) {
+    TaskGroup group;
+    split(group, begin, end, grain < 1 ? 1 : grain, f);
+    wait(group);
+  }
+
+private:
+  template <class F>
+  void split(TaskGroup & group, int begin, int end, int grain, const F & f) {
+    while (end - begin > grain) {
+      int mid = begin + (end - begin) / 2;
+      run(group, [this, &group, mid, end, grain, &f]() { split(group, mid, end, grain, f); });
+      end = mid;
+    }
+    for (int i = begin; i < end; ++i)
+      f(i);
+  }
+
+  /// Loop of workers 1 on: run tasks, or sleep until there are some.
+  void work(int index);
+
+  /// Takes a task for the given worker, from its own deque or another's.
+  bool take(int index, Task & task);
+
+  /// Runs a task and counts it off its group.
+  void execute(Task & task);
+};
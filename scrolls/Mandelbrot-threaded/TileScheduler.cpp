@@ -0,0 +1,167 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include "TileScheduler.h"
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point start)
+{
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+static bool longer(const TileWork & a, const TileWork & b)
+{
+  return a.predicted > b.predicted;
+}
+
+static const char * names[ORDER_COUNT] = { "cost", "rows", "morton", "hilbert" };
+
+const char * order_name(TileOrder order)
+{
+  if (order < 0 || order >= ORDER_COUNT)
+    return "unknown";
+  return names[order];
+}
+
+TileOrder order_parse(const char * name)
+{
+  for (int i = 0; i < ORDER_COUNT; ++i)
+    if (strcmp(name, names[i]) == 0)
+      return (TileOrder)i;
+  return ORDER_COUNT;
+}
+
+/// Distance along the Z-order curve: the bits of x and y interleaved.
+static long long morton(int x, int y)
+{
+  long long d = 0;
+  for (int b = 0; b < 31; ++b)
+    d |= (long long)((x >> b) & 1) << (2 * b) | (long long)((y >> b) & 1) << (2 * b + 1);
+  return d;
+}
+
+/// Distance along the Hilbert curve over an n by n square, n a power of 2.
+/// Each level picks the quadrant, then turns the square so that the curve
+/// enters the quadrant where the last one left.
+static long long hilbert(int n, int x, int y)
+{
+  long long d = 0;
+  for (int s = n / 2; s > 0; s /= 2) {
+    int rx = (x & s) > 0, ry = (y & s) > 0;
+    d += (long long)s * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
+TileScheduler::TileScheduler(int tiles_x, int tiles_y, int rows, TileOrder order)
+  : cost(tiles_x * tiles_y, 0.0)
+{
+  this->tiles = tiles_x * tiles_y;
+  this->rows = rows;
+  this->order = order;
+  this->last_imbalance = 1;
+  /// Frames that are not square powers of 2 take the curve over the square
+  /// that covers them, skipping the tiles off the frame.
+  int n = 1;
+  while (n < tiles_x || n < tiles_y)
+    n *= 2;
+  vector<pair<long long, int> > keyed;
+  for (int t = 0; t < tiles; ++t) {
+    int x = t % tiles_x, y = t / tiles_x;
+    long long d = order == ORDER_MORTON ? morton(x, y) : order == ORDER_HILBERT ? hilbert(n, x, y) : t;
+    keyed.push_back(make_pair(d, t));
+  }
+  sort(keyed.begin(), keyed.end());
+  curve.resize(tiles);
+  slots.resize(tiles);
+  for (int i = 0; i < tiles; ++i) {
+    curve[i] = keyed[i].second;
+    slots[curve[i]] = i;
+  }
+}
+
+const vector<TileWork> & TileScheduler::plan(int workers)
+{
+  double total = 0;
+  for (int t = 0; t < tiles; ++t)
+    total += cost[t];
+  double share = total / (workers * SPLIT);
+  work.clear();
+  for (int i = 0; i < tiles; ++i) {
+    int t = curve[i];
+    int pieces = share > 0 ? (int)ceil(cost[t] / share) : 1;
+    pieces = max(1, min(pieces, rows));
+    for (int p = 0; p < pieces; ++p) {
+      TileWork w = { t, rows * p / pieces, rows * (p + 1) / pieces, cost[t] / pieces, 0 };
+      work.push_back(w);
+    }
+  }
+  /// Stable, so that tiles with no time yet keep to row order.
+  if (order == ORDER_COST)
+    stable_sort(work.begin(), work.end(), longer);
+  return work;
+}
+
+bool TileScheduler::run(ThreadPool & pool, const function<void(int, int, int)> & f,
+                        const function<bool()> & cancelled)
+{
+  int workers = pool.active();
+  plan(workers);
+  int nodes = pool.nodes();
+  vector<vector<int> > lists(nodes);
+  for (size_t i = 0; i < work.size(); ++i)
+    lists[pool.node(slot(work[i].tile) * pool.size() / tiles)].push_back((int)i);
+  unique_ptr<atomic<int>[]> next(new atomic<int>[nodes]);
+  for (int k = 0; k < nodes; ++k)
+    next[k] = 0;
+  atomic<bool> skipped(false);
+  Clock::time_point start = Clock::now();
+  pool.parallel_for(0, workers, 1, [&](int) {
+    int home = pool.node(pool.current());
+    for (int k = 0; k < nodes; ++k) {
+      int node = (home + k) % nodes;
+      const vector<int> & list = lists[node];
+      int n = (int)list.size();
+      for (int i = next[node]++; i < n; i = next[node]++) {
+        if (cancelled()) {
+          skipped = true;
+          return;
+        }
+        TileWork & piece = work[list[i]];
+        Clock::time_point began = Clock::now();
+        f(piece.tile, piece.r1, piece.r2);
+        piece.seconds = seconds_since(began);
+      }
+    }
+  });
+  if (skipped)
+    return false;
+  double elapsed = seconds_since(start);
+  double busy = record(work);
+  last_imbalance = busy > 0 ? elapsed * workers / busy : 1;
+  return true;
+}
+
+double TileScheduler::record(const vector<TileWork> & pieces)
+{
+  double total = 0;
+  fill(cost.begin(), cost.end(), 0.0);
+  for (size_t i = 0; i < pieces.size(); ++i) {
+    cost[pieces[i].tile] += pieces[i].seconds;
+    total += pieces[i].seconds;
+  }
+  return total;
+}
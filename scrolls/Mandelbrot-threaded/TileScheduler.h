@@ -0,0 +1,102 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Schedules the tiles of a frame by what they cost in the frame before.
+#pragma once
+#include <functional>
+#include <vector>
+#include "ThreadPool.h"
+
+/// Orders to hand tiles out in, and to keep them in memory in.
+enum TileOrder {
+  ORDER_COST,      /// Most expensive first, by the frame before; rows in memory
+  ORDER_ROWS,      /// Row by row, as they are on screen
+  ORDER_MORTON,    /// Along the Z-order curve: 2x2 blocks, in 2x2 blocks, ...
+  ORDER_HILBERT,   /// Along the Hilbert curve, whose every step is to a neighbour
+  ORDER_COUNT
+};
+
+/// Name of the order, e.g. "hilbert".
+const char * order_name(TileOrder order);
+
+/// Looks up an order by name.  Returns ORDER_COUNT if unknown.
+TileOrder order_parse(const char * name);
+
+/// A piece of a frame: rows [r1, r2) of a tile, counted within the tile.
+struct TileWork {
+  int tile;
+  int r1, r2;
+  double predicted;   /// Seconds it should take, from the last frame
+  double seconds;     /// Seconds it took this frame
+};
+
+/// Escape-time views change little from one interactive frame to the next,
+/// and neither does what each tile costs.  So every piece of work is timed,
+/// and the next frame starts with the tiles that took longest.  Workers take
+/// pieces in that order from one shared index: each takes the longest left
+/// whenever it runs out, and the frame ends on the short ones rather than on
+/// one worker still busy with a tile in the set.
+///
+/// A tile predicted to take more than a small share of a worker's frame is
+/// split into strips of rows, so that no one piece can hold the frame up.
+/// Tiles with no time yet, as on the first frame, go in order, whole.
+///
+/// The curve orders hand the pieces out along a space-filling curve instead,
+/// not sorted by cost, so that the tiles in flight at once are close together
+/// on screen, and share cache lines and pages of the frame buffer; tiles laid
+/// out in memory along the same curve (see slot()) share them in the other
+/// buffers too.  What that saves against the cost of ending the frame on
+/// expensive tiles depends on the machine, so Benchmark measures both.
+///
+/// On a pool pinned to more than one NUMA node, the pieces are dealt out per
+/// node instead, by where their tile's memory is: buffers kept tile by tile
+/// and placed with ThreadPool::first_touch() put tile t on the node of worker
+/// slot(t) * size / tiles.  Workers take from their own node's pieces first, and
+/// only then help with another's.
+class TileScheduler
+{
+  int tiles;                     /// Tiles in a frame
+  int rows;                      /// Rows per tile, the most a tile is split into
+  TileOrder order;
+  std::vector<int> curve;        /// Tiles in the order of the curve, or of rows
+  std::vector<int> slots;        /// Place of each tile in curve
+  std::vector<double> cost;      /// Seconds each tile took in the last frame
+  std::vector<TileWork> work;    /// Pieces of the current frame, in the order they are taken
+  double last_imbalance;
+
+public:
+  /// Pieces each worker's share of a frame should split into at the least;
+  /// a tile predicted to take longer than its share over this is split.
+  enum { SPLIT = 8 };
+
+  /// Schedules a frame of tiles_x by tiles_y tiles, counted row by row, of
+  /// the given number of rows each.
+  TileScheduler(int tiles_x, int tiles_y, int rows, TileOrder order);
+
+  /// Calls f(tile, r1, r2) for every piece of the frame on pool, and returns
+  /// once all have returned.  Records what each tile took for the next frame.
+  ///
+  /// Each worker checks cancelled() before each piece it takes, and once it
+  /// returns true, takes no more.  Returns false if any piece was skipped, in
+  /// which case the times of the frame before are kept.
+  bool run(ThreadPool & pool, const std::function<void(int, int, int)> & f,
+           const std::function<bool()> & cancelled);
+
+  /// Orders and splits the tiles for a frame on the given number of workers,
+  /// from what they took in the last frame.
+  const std::vector<TileWork> & plan(int workers);
+
+  /// Place of the tile along the order's curve, from 0; tiles of buffers
+  /// laid out in this order are stored one after another.  The cost order
+  /// keeps rows.
+  int slot(int tile) const { return slots[tile]; }
+
+  /// Keeps the seconds the pieces of a frame took, added up by tile, for the
+  /// next plan().  Returns their total.
+  double record(const std::vector<TileWork> & pieces);
+
+  /// How much longer than perfectly spread work the last frame took: its
+  /// time over the work of all the pieces per worker.  1 is even; workers
+  /// sitting idle while others finish push it up.
+  double imbalance() const { return last_imbalance; }
+};
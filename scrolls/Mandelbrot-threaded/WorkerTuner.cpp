@@ -0,0 +1,80 @@
+/// Author: Xavier Ho (contact@xavierho.com)
+#include <algorithm>
+#include <iostream>
+#include "WorkerTuner.h"
+using namespace std;
+
+const double WorkerTuner::MARGIN = 0.03;
+
+WorkerTuner::WorkerTuner(int workers)
+{
+  this->most = workers < 1 ? 1 : workers;
+  this->best = most;
+  this->trying = most;
+  this->step = most > 1 ? max(1, most / 4) : 0;
+  queue_neighbours();
+}
+
+int WorkerTuner::frame(double ms, bool same_view)
+{
+  if (step == 0)
+    return best;
+  if (!same_view) {
+    /// Times from another view say nothing about this one.
+    frames.clear();
+    times.clear();
+    if (trying != best)
+      queue.push_back(trying);
+    trying = best;
+    return trying;
+  }
+  frames.push_back(ms);
+  if ((int)frames.size() < TRY_FRAMES)
+    return trying;
+  sort(frames.begin(), frames.end());
+  double median = frames[frames.size() / 2];
+  frames.clear();
+  times[trying] = median;
+  cout << trying << " workers: " << median << " ms per frame" << endl;
+  if (trying != best && median < times[best] * (1 - MARGIN)) {
+    best = trying;
+    queue.clear();
+    queue_neighbours();
+  }
+  next();
+  return trying;
+}
+
+void WorkerTuner::next()
+{
+  while (step > 0) {
+    if (times.find(best) == times.end()) {
+      trying = best;
+      return;
+    }
+    while (!queue.empty()) {
+      int count = queue.back();
+      queue.pop_back();
+      if (times.find(count) == times.end()) {
+        trying = count;
+        return;
+      }
+    }
+    step /= 2;
+    queue_neighbours();
+  }
+  trying = best;
+  cout << "Settled on " << best << " of " << most << " workers, " << times[best]
+       << " ms per frame" << endl;
+}
+
+void WorkerTuner::queue_neighbours()
+{
+  if (step == 0)
+    return;
+  /// Taken from the back, so fewer workers are tried first.
+  int counts[] = { best + step, best - step };
+  for (int i = 0; i < 2; ++i)
+    if (counts[i] >= 1 && counts[i] <= most && times.find(counts[i]) == times.end())
+      queue.push_back(counts[i]);
+}
@@ -0,0 +1,57 @@
+///
+/// Author: Xavier Ho (contact@xavierho.com)
+///
+/// Finds the number of workers that computes frames fastest on this machine.
+#pragma once
+#include <map>
+#include <vector>
+
+/// All the processors are not always the best number to use: hyperthreads
+/// share a core's execution units, memory bandwidth runs out, and other
+/// programs want their share.  The tuner times frames on different numbers of
+/// workers and keeps the fastest.
+///
+/// It starts from all of them and searches by steps of a quarter of that: it
+/// tries a step fewer and a step more, moves to whichever is faster, and
+/// halves the step once neither is, until it is down to single workers.  Each
+/// try is the median of a few frames.  Frames only count towards a try if the
+/// view did not change since the last, so that they cost the same; a change
+/// starts the current try over, and the best is timed again.
+///
+/// Each try and the final choice are printed.
+class WorkerTuner
+{
+  int most;                          /// Workers in the pool
+  int best;                          /// Fastest count found so far
+  int trying;                        /// Count the current frames run on
+  int step;                          /// Distance to the counts tried next, or 0 once settled
+  std::vector<int> queue;            /// Counts to try at this step
+  std::map<int, double> times;       /// Median ms per frame of each count tried for this view
+  std::vector<double> frames;        /// ms of the frames of the current try
+
+public:
+  /// Frames per try.
+  enum { TRY_FRAMES = 5 };
+
+  /// A count has to be this much faster than the best to replace it.
+  static const double MARGIN;
+
+  /// Tunes a pool of the given number of workers.
+  explicit WorkerTuner(int workers);
+
+  /// Takes the time a frame took to compute on the current count, and whether
+  /// its view was the same as the frame before's.  Returns the count to run
+  /// the next frame on.
+  int frame(double ms, bool same_view);
+
+  /// Whether the search is over.
+  bool settled() const { return step == 0; }
+
+private:
+  /// Picks the next count to try, or settles on the best.
+  void next();
+
+  /// Queues the counts a step either side of the best that have not been
+  /// tried for this view.
+  void queue_neighbours();
+};